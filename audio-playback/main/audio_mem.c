@@ -0,0 +1,217 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "audiosom32_driver.h"
+#include "audio_mem.h"
+
+static const char *TAG = "audio_mem.c";
+
+#define AUDIO_MEM_ALIGN(x)          (((x) + 3) & ~3)
+
+typedef struct
+{
+    const char *name;
+    size_t size;
+    size_t offset;              // Start of the pool within the arena
+    size_t used;
+    size_t peak;
+} audio_mem_pool_t;
+
+static audio_mem_pool_t pools[AUDIO_POOL_MAX] =
+{
+    { .name = "capture",  .size = AUDIO_MEM_ALIGN (AUDIO_MEM_CAPTURE_SIZE) },
+    { .name = "playback", .size = AUDIO_MEM_ALIGN (AUDIO_MEM_PLAYBACK_SIZE) },
+    { .name = "ring",     .size = AUDIO_MEM_ALIGN (AUDIO_MEM_RING_SIZE) },
+    { .name = "encoder",  .size = AUDIO_MEM_ALIGN (AUDIO_MEM_ENCODER_SIZE) },
+};
+
+static uint8_t *arena = NULL;
+static size_t arena_size = 0;
+static portMUX_TYPE mem_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+/*
+    Allocate the audio arena once from DMA-capable internal RAM.
+    Call at boot, before the heap gets fragmented by other allocations.
+*/
+esp_err_t audio_mem_init (void)
+{
+    int i;
+
+    if (arena != NULL)
+        return ESP_OK;
+
+    arena_size = 0;
+    for (i = 0; i < AUDIO_POOL_MAX; i++)
+    {
+        pools[i].offset = arena_size;
+        arena_size += pools[i].size;
+    }
+
+    if (arena_size == 0)
+        return ESP_OK;
+
+    arena = heap_caps_malloc (arena_size, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (arena == NULL)
+    {
+        ESP_LOGE (TAG, "Failed to allocate %d byte audio arena", arena_size);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI (TAG, "Audio arena: %d bytes at %p", arena_size, arena);
+    return ESP_OK;
+}
+
+/*
+    Carve size bytes (rounded up to 4) out of a pool.
+    Memory lives as long as the pool, there is no individual free.
+    Returns NULL if the pool is exhausted, increase its AUDIO_MEM_xxx_SIZE
+*/
+void *audio_mem_alloc (audio_pool_t pool, size_t size)
+{
+    void *ptr = NULL;
+
+    if (arena == NULL || pool >= AUDIO_POOL_MAX)
+        return NULL;
+
+    size = AUDIO_MEM_ALIGN (size);
+
+    portENTER_CRITICAL (&mem_spinlock);
+    if (pools[pool].used + size <= pools[pool].size)
+    {
+        ptr = arena + pools[pool].offset + pools[pool].used;
+        pools[pool].used += size;
+        if (pools[pool].used > pools[pool].peak)
+            pools[pool].peak = pools[pool].used;
+    }
+    portEXIT_CRITICAL (&mem_spinlock);
+
+    if (ptr == NULL)
+        ESP_LOGE (TAG, "Pool %s exhausted: %d of %d bytes used, %d requested",
+            pools[pool].name, pools[pool].used, pools[pool].size, size);
+
+    return ptr;
+}
+
+/*
+    Give back everything allocated from a pool, e.g. when switching modes.
+    The caller must make sure nothing uses the old allocations anymore.
+*/
+void audio_mem_reset (audio_pool_t pool)
+{
+    if (pool >= AUDIO_POOL_MAX)
+        return;
+
+    portENTER_CRITICAL (&mem_spinlock);
+    pools[pool].used = 0;
+    portEXIT_CRITICAL (&mem_spinlock);
+}
+
+/*
+    Print size, current and peak usage of every pool, plus the DMA buffers
+    allocated by the I2S driver which live outside the arena
+*/
+void audio_mem_report (void)
+{
+    size_t used = 0, peak = 0, dma;
+    int i;
+
+    printf ("%-10s %8s %8s %8s\n", "Pool", "Size", "Used", "Peak");
+    for (i = 0; i < AUDIO_POOL_MAX; i++)
+    {
+        printf ("%-10s %8d %8d %8d\n", pools[i].name, pools[i].size, pools[i].used, pools[i].peak);
+        used += pools[i].used;
+        peak += pools[i].peak;
+    }
+    printf ("%-10s %8d %8d %8d\n", "arena", arena_size, used, peak);
+
+    // TX and RX rings, 2 channels per frame, plus one 12-byte lldesc_t per buffer
+    dma = 2 * AUDIOSOM32_DMA_BUF_COUNT * (AUDIOSOM32_DMA_BUF_LEN * 2 * AUDIOSOM32_BITSPERSAMPLE/8 + 12);
+    printf ("%-10s %8d (I2S driver, outside arena)\n", "i2s dma", dma);
+}
+
+/*
+    Split count blocks of block_size bytes off a pool and put them on the
+    free list. Blocks are word aligned and DMA-capable like the rest of the arena.
+*/
+esp_err_t audio_block_pool_init (audio_block_pool_t *bp, audio_pool_t pool, size_t block_size, uint32_t count)
+{
+    uint8_t *blocks;
+    uint32_t i;
+
+    block_size = AUDIO_MEM_ALIGN (block_size);
+    blocks = audio_mem_alloc (pool, block_size * count);
+    if (blocks == NULL)
+        return ESP_ERR_NO_MEM;
+
+    bp->free = xQueueCreate (count, sizeof (void *));
+    if (bp->free == NULL)
+        return ESP_ERR_NO_MEM;
+
+    for (i = 0; i < count; i++)
+    {
+        void *block = blocks + i * block_size;
+        xQueueSend (bp->free, &block, 0);
+    }
+    bp->block_size = block_size;
+    bp->count = count;
+    bp->min_free = count;
+
+    return ESP_OK;
+}
+
+/*
+    Take ownership of a free block, NULL if none is free within wait ticks
+*/
+void *audio_block_get (audio_block_pool_t *bp, TickType_t wait)
+{
+    void *block;
+    UBaseType_t free;
+
+    if (xQueueReceive (bp->free, &block, wait) != pdTRUE)
+        return NULL;
+
+    free = uxQueueMessagesWaiting (bp->free);
+    if (free < bp->min_free)
+        bp->min_free = free;
+
+    return block;
+}
+
+/*
+    Return a block to its pool, the caller must not touch it afterwards
+*/
+void audio_block_put (audio_block_pool_t *bp, void *block)
+{
+    xQueueSend (bp->free, &block, 0);
+}
@@ -0,0 +1,45 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+
+#ifndef _AUDIO_MEM_CONFIG_H_
+#define _AUDIO_MEM_CONFIG_H_
+
+/*
+    Settings of the modules that carve blocks from the audio arena, and the
+    pool sizes built from them. The module headers and audio_mem.h include
+    this, it includes nothing, so the sizes do not depend on include order.
+*/
+
+// Player (player.h)
+// Bytes handed to i2s_write per block (16-bit stereo, 128 frames)
+#define PLAYER_BLOCK_SIZE           512
+
+// Pool sizes in bytes, the arena is the sum of all pools (each rounded up to 4 bytes)
+#define AUDIO_MEM_CAPTURE_SIZE      0
+#define AUDIO_MEM_PLAYBACK_SIZE     PLAYER_BLOCK_SIZE       // One block for the player
+#define AUDIO_MEM_RING_SIZE         0
+#define AUDIO_MEM_ENCODER_SIZE      0
+
+#endif
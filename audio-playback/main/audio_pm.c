@@ -0,0 +1,240 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_pm.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "audio_pm.h"
+
+static const char *TAG = "audio_pm.c";
+
+static const char *mode_names[] = { "performance", "balanced", "low power" };
+
+static audio_pm_mode_t pm_mode = AUDIO_PM_PERFORMANCE;
+static portMUX_TYPE pm_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static int work_count = 0;
+static bool streaming = false;
+
+// Time spent in each state since audio_pm_init (), in microseconds
+static int64_t last_change = 0;
+static int64_t time_work = 0;
+static int64_t time_stream = 0;
+static int64_t time_parked = 0;
+
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t cpu_lock = NULL;        // Max CPU clock while audio work is pending
+static esp_pm_lock_handle_t apb_lock = NULL;        // Keeps PLL and APB at 80 MHz so MCLK/BCLK never move
+static esp_pm_lock_handle_t sleep_lock = NULL;      // No light sleep while the codec needs MCLK
+#endif
+
+/*
+    Close the current accounting period, call with pm_spinlock held
+*/
+static void audio_pm_account (void)
+{
+    int64_t now = esp_timer_get_time ();
+
+    if (work_count > 0)
+        time_work += now - last_change;
+    else if (streaming)
+        time_stream += now - last_change;
+    else
+        time_parked += now - last_change;
+    last_change = now;
+}
+
+/*
+    Configure dynamic frequency scaling and light sleep for the selected mode.
+    Call once at boot, before the I2S driver starts streaming.
+*/
+esp_err_t audio_pm_init (audio_pm_mode_t mode)
+{
+#if CONFIG_PM_ENABLE
+    esp_pm_config_esp32_t pm_config =
+    {
+        .max_freq_mhz = CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = (mode == AUDIO_PM_PERFORMANCE) ? CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ : AUDIO_PM_MIN_FREQ_MHZ,
+        .light_sleep_enable = (mode == AUDIO_PM_LOW_POWER)
+    };
+
+#if !CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    if (mode == AUDIO_PM_LOW_POWER)
+    {
+        ESP_LOGW (TAG, "Light sleep needs CONFIG_FREERTOS_USE_TICKLESS_IDLE, using balanced mode");
+        pm_config.light_sleep_enable = false;
+        mode = AUDIO_PM_BALANCED;
+    }
+#endif
+
+    if (esp_pm_lock_create (ESP_PM_CPU_FREQ_MAX, 0, "audio_work", &cpu_lock) != ESP_OK)
+        return ESP_FAIL;
+    if (esp_pm_lock_create (ESP_PM_APB_FREQ_MAX, 0, "audio_i2s_apb", &apb_lock) != ESP_OK)
+        return ESP_FAIL;
+    if (esp_pm_lock_create (ESP_PM_NO_LIGHT_SLEEP, 0, "audio_i2s_mclk", &sleep_lock) != ESP_OK)
+        return ESP_FAIL;
+    if (esp_pm_configure (&pm_config) != ESP_OK)
+        return ESP_FAIL;
+#else
+    if (mode != AUDIO_PM_PERFORMANCE)
+    {
+        ESP_LOGW (TAG, "CONFIG_PM_ENABLE is not set, CPU stays at %d MHz", CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ);
+        mode = AUDIO_PM_PERFORMANCE;
+    }
+#endif
+
+    portENTER_CRITICAL (&pm_spinlock);
+    pm_mode = mode;
+    last_change = esp_timer_get_time ();
+    time_work = time_stream = time_parked = 0;
+    portEXIT_CRITICAL (&pm_spinlock);
+
+    ESP_LOGI (TAG, "Power mode: %s", mode_names[mode]);
+    return ESP_OK;
+}
+
+/*
+    I2S is about to clock the codec. MCLK is derived from the PLL, so keep
+    APB at max and forbid light sleep until audio_pm_stream_stop ().
+*/
+void audio_pm_stream_start (void)
+{
+    portENTER_CRITICAL (&pm_spinlock);
+    if (streaming)
+    {
+        portEXIT_CRITICAL (&pm_spinlock);
+        return;
+    }
+    audio_pm_account ();
+    streaming = true;
+    portEXIT_CRITICAL (&pm_spinlock);
+
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_acquire (apb_lock);
+    esp_pm_lock_acquire (sleep_lock);
+#endif
+}
+
+/*
+    I2S is stopped and the codec no longer needs MCLK
+*/
+void audio_pm_stream_stop (void)
+{
+    portENTER_CRITICAL (&pm_spinlock);
+    if (!streaming)
+    {
+        portEXIT_CRITICAL (&pm_spinlock);
+        return;
+    }
+    audio_pm_account ();
+    streaming = false;
+    portEXIT_CRITICAL (&pm_spinlock);
+
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_release (sleep_lock);
+    esp_pm_lock_release (apb_lock);
+#endif
+}
+
+/*
+    Audio work is pending (a block must be produced or consumed), run the
+    CPU at max frequency until the matching audio_pm_work_end ().
+    Calls may nest and may come from several tasks.
+    Do not hold the lock across a blocking i2s_read/i2s_write!
+*/
+void audio_pm_work_begin (void)
+{
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_acquire (cpu_lock);
+#endif
+    portENTER_CRITICAL (&pm_spinlock);
+    if (work_count == 0)
+        audio_pm_account ();
+    work_count++;
+    portEXIT_CRITICAL (&pm_spinlock);
+}
+
+void audio_pm_work_end (void)
+{
+    portENTER_CRITICAL (&pm_spinlock);
+    if (work_count == 1)
+        audio_pm_account ();
+    if (work_count > 0)
+        work_count--;
+    portEXIT_CRITICAL (&pm_spinlock);
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_release (cpu_lock);
+#endif
+}
+
+/*
+    Print the time spent working, streaming and parked, and the supply
+    current estimated from the AUDIO_PM_CURRENT_xxx figures compared to
+    running at fixed max frequency.
+*/
+void audio_pm_report (void)
+{
+    int64_t work, stream, parked, total;
+    uint32_t current_stream, current_parked, average;
+
+    portENTER_CRITICAL (&pm_spinlock);
+    audio_pm_account ();
+    work = time_work;
+    stream = time_stream;
+    parked = time_parked;
+    portEXIT_CRITICAL (&pm_spinlock);
+
+    total = work + stream + parked;
+    if (total == 0)
+        return;
+
+    // Current drawn in each state for the active mode, work always runs at max frequency
+    current_stream = (pm_mode == AUDIO_PM_PERFORMANCE) ? AUDIO_PM_CURRENT_MAX_FREQ : AUDIO_PM_CURRENT_MIN_FREQ;
+    if (pm_mode == AUDIO_PM_PERFORMANCE)
+        current_parked = AUDIO_PM_CURRENT_MAX_FREQ;
+    else if (pm_mode == AUDIO_PM_BALANCED)
+        current_parked = AUDIO_PM_CURRENT_MIN_FREQ;
+    else
+        current_parked = AUDIO_PM_CURRENT_SLEEP;
+
+    average = (uint32_t) ((work * AUDIO_PM_CURRENT_MAX_FREQ + stream * current_stream + parked * current_parked) / total);
+
+    ESP_LOGI (TAG, "Mode %s: work %d%%, streaming %d%%, parked %d%% of %d s",
+        mode_names[pm_mode], (int) (work * 100 / total), (int) (stream * 100 / total),
+        (int) (parked * 100 / total), (int) (total / 1000000));
+    ESP_LOGI (TAG, "Estimated supply current %d.%d mA, saving %d.%d mA vs. fixed %d MHz",
+        average / 10, average % 10,
+        (AUDIO_PM_CURRENT_MAX_FREQ - average) / 10, (AUDIO_PM_CURRENT_MAX_FREQ - average) % 10,
+        CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ);
+#if CONFIG_PM_ENABLE && CONFIG_PM_PROFILING
+    esp_pm_dump_locks (stdout);
+#endif
+}
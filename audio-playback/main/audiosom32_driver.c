@@ -23,6 +23,7 @@ software.
 */
 
 #include <string.h>
+#include <math.h>
 #include "esp_log.h"
 #include "soc/rtc.h"
 #include "soc/soc.h"
@@ -39,8 +40,8 @@ static i2s_config_t audiosom32_i2s_config = {
     .bits_per_sample = AUDIOSOM32_BITSPERSAMPLE,                              //16-bit per channel
     .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,                           //2-channels
     .communication_format = I2S_COMM_FORMAT_I2S | I2S_COMM_FORMAT_I2S_MSB,
-    .dma_buf_count = 6,
-    .dma_buf_len = 512,                                                      //
+    .dma_buf_count = AUDIOSOM32_DMA_BUF_COUNT,
+    .dma_buf_len = AUDIOSOM32_DMA_BUF_LEN,                                   //
     .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1                                //Interrupt level 1
 };
 
@@ -161,6 +162,115 @@ esp_err_t audiosom32_set_mic_gain (uint8_t gain)
         return ESP_FAIL;
 }
 
+/*
+    ANA_ADC_CTRL value for an ADC volume, both channels
+*/
+static uint16_t audiosom32_adc_volume_code (float db)
+{
+    uint16_t code;
+
+    db = fminf (fmaxf (db, AUDIOSOM32_ADC_VOL_MIN_DB), AUDIOSOM32_ADC_VOL_MAX_DB);
+
+    // Below 0 dB use the -6 dB range shift (ADC_VOL_M6DB)
+    if (db < 0)
+        code = 0x0100 | lroundf ((db + 6) / 1.5f);
+    else
+        code = lroundf (db / 1.5f);
+
+    return (code & 0x0100) | ((code & 0x0F) << 4) | (code & 0x0F);
+}
+
+/*
+    Set the analog ADC input volume for both channels in 1.5 dB steps
+    Range: -6 dB to +22.5 dB (AUDIOSOM32_ADC_VOL_MIN_DB/MAX_DB)
+    Changes wait for a zero crossing when ADC ZCD is enabled
+*/
+esp_err_t audiosom32_set_adc_volume (float db)
+{
+    uint16_t readval;
+
+    if (audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_ADC_CTRL, &readval) != ESP_OK)
+        return ESP_FAIL;
+    readval = (readval & 0xFE00) | audiosom32_adc_volume_code (db);
+    if (audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_ADC_CTRL, readval) == 0)
+        return ESP_OK;
+    else
+        return ESP_FAIL;
+}
+
+/*
+    Switch the capture input and set its analog gain, bias and monitoring
+    in one short register sequence, without re-running the init:
+    ADC muted -> MIC_CTRL -> ADC volume -> (SSS_CTRL) -> ANA_CTRL with the
+    new ADC source, ADC unmuted. A few milliseconds over I2C.
+
+    Monitoring: line in is heard through the analog HP bypass, the mic
+    through ADC -> DAC inside the codec. If the ESP32 (I2S in) or the DAP
+    feeds the DAC, HP stays on the DAC and that route is kept.
+*/
+esp_err_t audiosom32_set_capture (const audiosom32_capture_t *capture)
+{
+    uint16_t ana, sss, mic;
+    uint16_t voltage = capture->mic_bias_mv;
+    uint8_t dac_codec;
+    esp_err_t ret = ESP_OK;
+
+    if (voltage < 1250 || voltage > 3000 || voltage > AUDIOSOM32_VDDA - 200)
+        return ESP_ERR_INVALID_ARG;
+
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_CTRL, &ana);
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_SSS_CTRL, &sss);
+    if (ret != ESP_OK)
+        return ESP_FAIL;
+
+    // Mute the ADC while its source and gain change
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_CTRL, ana | 0x0001);
+
+    // Mic preamp gain, bias resistor and voltage. Bias is off for line in
+    mic = 0x0000;
+    if (capture->source == AUDIOSOM32_INPUT_MIC)
+        mic = ((capture->mic_bias & 0x03) << 8) | (((voltage - 1250) / 250) << 4) |
+              (capture->mic_gain > 3 ? 3 : capture->mic_gain);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_MIC_CTRL, mic);
+
+    // ADC volume, the register holds nothing else
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_ADC_CTRL, audiosom32_adc_volume_code (capture->adc_db));
+
+    // DAC fed by the ADC (DAC_SELECT 0) means the codec monitors by itself
+    dac_codec = (sss & 0x0030) == 0x0000;
+    if (capture->source == AUDIOSOM32_INPUT_MIC && (ana & 0x0040))
+    {
+        // HP was on the line in bypass, the mic can only be heard through the DAC
+        if (!dac_codec)
+        {
+            sss &= 0xFFCF;
+            ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_SSS_CTRL, sss);
+        }
+        ana &= 0xFFBF;
+    }
+    else if (capture->source == AUDIOSOM32_INPUT_LINE_IN && !(ana & 0x0040) && dac_codec)
+    {
+        // Codec internal monitoring of line in is better done by the analog bypass
+        ana |= 0x0040;
+    }
+
+    // SELECT_ADC: mic (bit 2 clear) or line in (bit 2 set), ADC unmuted, HP mute as asked
+    if (capture->source == AUDIOSOM32_INPUT_LINE_IN)
+        ana |= 0x0004;
+    else
+        ana &= 0xFFFB;
+    if (capture->monitor)
+        ana &= 0xFFEF;
+    else
+        ana |= 0x0010;
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_CTRL, ana & 0xFFFE);
+
+    if (ret == ESP_OK)
+        return ESP_OK;
+    else
+        return ESP_FAIL;
+}
+
 /*
     Mute the headphone output
 */
@@ -276,6 +386,119 @@ esp_err_t audiosom32_set_headphone_volume (int8_t left_vol, int8_t right_vol)
         return ESP_FAIL;
 }
 
+/*
+    Set DAC or headphone volume in 0.5 dB steps, clamped to the range of the output
+    (AUDIOSOM32_DAC_VOL_MIN_DB/MAX_DB, AUDIOSOM32_HP_VOL_MIN_DB/MAX_DB).
+    With the DAC volume ramp and HP zero-cross detection enabled, each write
+    is applied without a click.
+*/
+esp_err_t audiosom32_set_volume_db (audiosom32_volume_t out, float left_db, float right_db)
+{
+    float min_db, max_db;
+    uint16_t left, right, reg, base;
+
+    if (out == AUDIOSOM32_VOLUME_DAC)
+    {
+        min_db = AUDIOSOM32_DAC_VOL_MIN_DB;
+        max_db = AUDIOSOM32_DAC_VOL_MAX_DB;
+        reg = SGTL5000_CHIP_DAC_VOL;
+        base = 0x3C;
+    }
+    else
+    {
+        min_db = AUDIOSOM32_HP_VOL_MIN_DB;
+        max_db = AUDIOSOM32_HP_VOL_MAX_DB;
+        reg = SGTL5000_CHIP_ANA_HP_CTRL;
+        base = 0x18;
+    }
+
+    left_db = fminf (fmaxf (left_db, min_db), max_db);
+    right_db = fminf (fmaxf (right_db, min_db), max_db);
+
+    // Both registers count 0.5 dB of attenuation per step from the 0 dB code
+    left = (base + lroundf (-2*left_db)) & 0xFF;
+    right = (base + lroundf (-2*right_db)) & 0xFF;
+
+    if (audiosom32_write_reg (AUDIOSOM32_I2C_NUM, reg, (right << 8)|left) == 0)
+        return ESP_OK;
+    else
+        return ESP_FAIL;
+}
+
+/*
+    Read back the DAC or headphone volume in dB
+*/
+esp_err_t audiosom32_get_volume_db (audiosom32_volume_t out, float *left_db, float *right_db)
+{
+    uint16_t readval;
+
+    if (out == AUDIOSOM32_VOLUME_DAC)
+    {
+        if (audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_DAC_VOL, &readval) != ESP_OK)
+            return ESP_FAIL;
+        *left_db = (0x3C - (int) (readval & 0xFF)) / 2.0f;
+        *right_db = (0x3C - (int) (readval >> 8)) / 2.0f;
+        *left_db = fmaxf (*left_db, AUDIOSOM32_DAC_VOL_MIN_DB);
+        *right_db = fmaxf (*right_db, AUDIOSOM32_DAC_VOL_MIN_DB);
+    }
+    else
+    {
+        if (audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_HP_CTRL, &readval) != ESP_OK)
+            return ESP_FAIL;
+        *left_db = (0x18 - (int) (readval & 0x7F)) / 2.0f;
+        *right_db = (0x18 - (int) ((readval >> 8) & 0x7F)) / 2.0f;
+    }
+
+    return ESP_OK;
+}
+
+/*
+    DAC volume ramp: volume changes and mute/unmute slide to the new value
+    in 0.5 dB steps inside the codec instead of jumping.
+    exponential = 0: linear ramp, 1: exponential ramp
+*/
+esp_err_t audiosom32_set_volume_ramp (uint8_t enable, uint8_t exponential)
+{
+    uint16_t readval;
+    esp_err_t ret = ESP_OK;
+
+    // VOL_RAMP_EN is bit 9, VOL_EXPO_RAMP is bit 8
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ADCDAC_CTRL, &readval);
+    readval &= 0xFCFF;
+    if (enable)
+        readval |= 0x0200 | (exponential ? 0x0100 : 0x0000);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ADCDAC_CTRL, readval);
+
+    if (ret == ESP_OK)
+        return ESP_OK;
+    else
+        return ESP_FAIL;
+}
+
+/*
+    Headphone zero-cross detection: HP volume changes wait for the next
+    zero crossing of the signal. Without a signal they may not apply at all,
+    so leave it off while the output is idle.
+*/
+esp_err_t audiosom32_set_hp_zcd (uint8_t enable)
+{
+    uint16_t readval;
+    esp_err_t ret = ESP_OK;
+
+    // EN_ZCD_HP is bit 5
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_CTRL, &readval);
+    if (enable)
+        readval |= 0x0020;
+    else
+        readval &= 0xFFDF;
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_CTRL, readval);
+
+    if (ret == ESP_OK)
+        return ESP_OK;
+    else
+        return ESP_FAIL;
+}
+
 /*
     Set digital pad drive strength. Setting high drive strength causes
     more noise and more power rail noise.
@@ -300,6 +523,351 @@ esp_err_t audiosom32_pin_drive_strength (uint8_t i2c_strength, uint8_t i2s_stren
         return ESP_FAIL;
 }
 
+/*
+    Pop-free power down of the DAC and headphone amplifier while nothing is playing.
+    DAC is muted first, then HP, then both are powered down.
+    VAG and the reference stay up, ramping them is what causes loud pops.
+    Call while MCLK is still running, before i2s_stop ()
+*/
+esp_err_t audiosom32_power_down_output (void)
+{
+    uint16_t readval;
+    esp_err_t ret = ESP_OK;
+
+    // Mute DAC left and right
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ADCDAC_CTRL, &readval);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ADCDAC_CTRL, readval | 0x000C);
+
+    // With the volume ramp enabled the mute slides down, let it finish
+    if (readval & 0x0200)
+        ets_delay_us (AUDIOSOM32_DAC_RAMP_US);
+
+    // Mute HP
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_CTRL, &readval);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_CTRL, readval | 0x0010);
+
+    // Power down HP and DAC analog sections
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_POWER, &readval);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_POWER, readval & 0xFFE7);
+
+    // Power down DAC digital block
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_DIG_POWER, &readval);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_DIG_POWER, readval & 0xFFDF);
+
+    if (ret == ESP_OK)
+        return ESP_OK;
+    else
+        return ESP_FAIL;
+}
+
+/*
+    Reverse of audiosom32_power_down_output ()
+    Call after i2s_start (), the codec needs MCLK for I2C access
+*/
+esp_err_t audiosom32_power_up_output (void)
+{
+    uint16_t readval;
+    esp_err_t ret = ESP_OK;
+
+    // Power up DAC digital block
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_DIG_POWER, &readval);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_DIG_POWER, readval | 0x0020);
+
+    // Power up HP and DAC analog sections, HP output settles in about 1ms
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_POWER, &readval);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_POWER, readval | 0x0018);
+    ets_delay_us (1000);
+
+    // Unmute HP
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_CTRL, &readval);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_CTRL, readval & 0xFFEF);
+
+    // Unmute DAC left and right
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ADCDAC_CTRL, &readval);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ADCDAC_CTRL, readval & 0xFFF3);
+
+    if (ret == ESP_OK)
+        return ESP_OK;
+    else
+        return ESP_FAIL;
+}
+
+/*
+    Headphone monitoring source
+    0: Line in -> HP directly (analog bypass, nothing can be applied to it)
+    1: I2S in -> DAC -> HP, so the ESP32 decides what is heard (full-duplex)
+    The ADC (or DAP) -> I2S out route is not changed.
+*/
+esp_err_t audiosom32_route_monitor (uint8_t digital)
+{
+    uint16_t readval, sss;
+    esp_err_t ret = ESP_OK;
+
+    // Mute HP while switching its source
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_CTRL, &readval);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_CTRL, readval | 0x0010);
+
+    // DAC_SELECT: ADC (0x0000) or I2S_IN (0x0010), leave it alone if the DAP feeds the DAC
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_SSS_CTRL, &sss);
+    if ((sss & 0x0030) != 0x0030)
+    {
+        sss = (sss & 0xFFCF) | (digital ? 0x0010 : 0x0000);
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_SSS_CTRL, sss);
+    }
+
+    // SELECT_HP: DAC (bit 6 clear) or line in (bit 6 set), then unmute HP
+    if (digital)
+        readval &= 0xFFBF;
+    else
+        readval |= 0x0040;
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_CTRL, readval & 0xFFEF);
+
+    // Power up DAC digital block and the DAC analog section
+    if (digital)
+    {
+        ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_DIG_POWER, &readval);
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_DIG_POWER, readval | 0x0020);
+        ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_POWER, &readval);
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ANA_POWER, readval | 0x0008);
+    }
+
+    if (ret == ESP_OK)
+        return ESP_OK;
+    else
+        return ESP_FAIL;
+}
+
+/*
+    Convert a biquad with a0 normalized to 1 (y = b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2)
+    to the DAP format. Every coefficient must be within +/-2.
+*/
+esp_err_t audiosom32_biquad_raw (float b0, float b1, float b2, float a1, float a2, audiosom32_biquad_t *biquad)
+{
+    const float c[5] = { b0, b1, b2, -a1, -a2 };
+    int32_t q[5];
+    int i;
+
+    for (i = 0; i < 5; i++)
+    {
+        if (c[i] >= 2.0f || c[i] < -2.0f)
+            return ESP_ERR_INVALID_ARG;
+        q[i] = (int32_t) lroundf (c[i] * 262144.0f);
+        if (q[i] > 0x7FFFF)
+            q[i] = 0x7FFFF;
+    }
+
+    biquad->b0 = q[0];
+    biquad->b1 = q[1];
+    biquad->b2 = q[2];
+    biquad->a1 = q[3];
+    biquad->a2 = q[4];
+
+    return ESP_OK;
+}
+
+/*
+    Design a biquad for the DAP, see biquad_calc ()
+*/
+esp_err_t audiosom32_biquad_design (biquad_type_t type, float freq, float q, float gain_db, audiosom32_biquad_t *biquad)
+{
+    float c[5];
+
+    if (biquad_calc (type, freq, q, gain_db, AUDIOSOM32_SAMPLERATE, c) != ESP_OK)
+        return ESP_ERR_INVALID_ARG;
+
+    return audiosom32_biquad_raw (c[0], c[1], c[2], c[3], c[4], biquad);
+}
+
+/*
+    Write one 20-bit coefficient to its MSB (bits 19:4) and LSB (bits 3:0) registers
+*/
+static esp_err_t audiosom32_write_coef (uint16_t msb_reg, uint16_t lsb_reg, int32_t coef)
+{
+    esp_err_t ret = ESP_OK;
+
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, msb_reg, (coef >> 4) & 0xFFFF);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, lsb_reg, coef & 0x000F);
+
+    return ret;
+}
+
+/*
+    Upload up to AUDIOSOM32_DAP_MAX_BIQUADS biquads to the DAP PEQ and enable them.
+    The codec latches the five coefficients of a filter together when it is
+    selected in DAP_FILTER_COEF_ACCESS, so a half written filter is never used.
+    count 0 disables the EQ. Route the DAP with audiosom32_dap_route ().
+*/
+esp_err_t audiosom32_dap_set_eq (const audiosom32_biquad_t *biquads, uint8_t count)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t i;
+
+    if (count > AUDIOSOM32_DAP_MAX_BIQUADS)
+        return ESP_ERR_INVALID_ARG;
+
+    for (i = 0; i < count; i++)
+    {
+        ret |= audiosom32_write_coef (SGTL5000_DAP_COEF_WR_B0_MSB, SGTL5000_DAP_COEF_WR_B0_LSB, biquads[i].b0);
+        ret |= audiosom32_write_coef (SGTL5000_DAP_COEF_WR_B1_MSB, SGTL5000_DAP_COEF_WR_B1_LSB, biquads[i].b1);
+        ret |= audiosom32_write_coef (SGTL5000_DAP_COEF_WR_B2_MSB, SGTL5000_DAP_COEF_WR_B2_LSB, biquads[i].b2);
+        ret |= audiosom32_write_coef (SGTL5000_DAP_COEF_WR_A1_MSB, SGTL5000_DAP_COEF_WR_A1_LSB, biquads[i].a1);
+        ret |= audiosom32_write_coef (SGTL5000_DAP_COEF_WR_A2_MSB, SGTL5000_DAP_COEF_WR_A2_LSB, biquads[i].a2);
+
+        // WR bit plus filter index loads the coefficients
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_FILTER_COEF_ACCESS, 0x0100 | i);
+    }
+
+    // Number of filters in use, then PEQ mode for the audio EQ (or off)
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_PEQ, count);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_AUDIO_EQ, count ? 0x0001 : 0x0000);
+
+    if (ret == ESP_OK)
+        return ESP_OK;
+    else
+        return ESP_FAIL;
+}
+
+/*
+    Put the DAP into the record or playback path, or take it out
+    Record:   ADC -> DAP -> I2S out
+    Playback: I2S in -> DAP -> DAC
+    Off:      I2S out from the ADC, DAC from I2S in, DAP powered down
+*/
+esp_err_t audiosom32_dap_route (audiosom32_dap_route_t route)
+{
+    uint16_t readval, sss;
+    esp_err_t ret = ESP_OK;
+
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_SSS_CTRL, &sss);
+    if ((sss & 0x0003) == 0x0003)
+        sss &= 0xFFFC;                      // I2S_SELECT back to ADC
+    if ((sss & 0x0030) == 0x0030)
+        sss = (sss & 0xFFCF) | 0x0010;      // DAC_SELECT back to I2S in
+    sss &= 0xFC3F;                          // DAP_SELECT and DAP_MIX_SELECT to ADC
+
+    if (route == AUDIOSOM32_DAP_RECORD)
+        sss |= 0x0003;                      // DAP_SELECT ADC, I2S_SELECT DAP
+    else if (route == AUDIOSOM32_DAP_PLAYBACK)
+        sss |= 0x0040 | 0x0030;             // DAP_SELECT I2S in, DAC_SELECT DAP
+
+    if (route != AUDIOSOM32_DAP_OFF)
+    {
+        // Power up the DAP, full main channel, no mix channel
+        ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_DIG_POWER, &readval);
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_DIG_POWER, readval | 0x0010);
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_MAIN_CHAN, 0x8000);
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_MIX_CHAN, 0x0000);
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_CONTROL, 0x0001);
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_SSS_CTRL, sss);
+    }
+    else
+    {
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_SSS_CTRL, sss);
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_CONTROL, 0x0000);
+        ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_DIG_POWER, &readval);
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_DIG_POWER, readval & 0xFFEF);
+    }
+
+    if (ret == ESP_OK)
+        return ESP_OK;
+    else
+        return ESP_FAIL;
+}
+
+/*
+    Configure and enable the DAP automatic volume control, NULL disables it.
+    The AVC changes the gain at a constant rate (dB/s), attack and decay
+    times are converted to that rate over AUDIOSOM32_AVC_SPAN_DB.
+    Only active while the DAP is routed (audiosom32_dap_route ()).
+*/
+esp_err_t audiosom32_dap_set_avc (const audiosom32_avc_t *avc)
+{
+    uint16_t readval, ctrl;
+    float threshold, attack, decay;
+    esp_err_t ret = ESP_OK;
+
+    ret |= audiosom32_read_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_AVC_CTRL, &readval);
+    if (avc == NULL)
+    {
+        ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_AVC_CTRL, readval & 0xFFFE);
+        return (ret == ESP_OK) ? ESP_OK : ESP_FAIL;
+    }
+
+    if (avc->threshold_db > 0 || avc->threshold_db < -96 || avc->attack_ms <= 0 || avc->decay_ms <= 0)
+        return ESP_ERR_INVALID_ARG;
+
+    // THRESHOLD = 10^(dB/20) * 0.636 * 2^15
+    threshold = powf (10, avc->threshold_db / 20) * 0.636f * 32768;
+    // ATTACK = (1 - 10^(-rate / (20 * Fs))) * 2^19, DECAY the same with 2^23
+    attack = (1 - powf (10, -(AUDIOSOM32_AVC_SPAN_DB * 1000 / avc->attack_ms) / (20.0f * AUDIOSOM32_SAMPLERATE))) * 524288;
+    decay = (1 - powf (10, -(AUDIOSOM32_AVC_SPAN_DB * 1000 / avc->decay_ms) / (20.0f * AUDIOSOM32_SAMPLERATE))) * 8388608;
+
+    // Both rate registers are 12 bits, 1 is the slowest rate
+    attack = (attack < 1) ? 1 : (attack > 0xFFF) ? 0xFFF : attack;
+    decay = (decay < 1) ? 1 : (decay > 0xFFF) ? 0xFFF : decay;
+
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_AVC_THRESHOLD, (uint16_t) threshold);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_AVC_ATTACK, (uint16_t) attack);
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_AVC_DECAY, (uint16_t) decay);
+
+    // MAX_GAIN 13:12, LBI_RESPONSE 9:8 (kept), HARD_LIMIT_EN 5, EN 0
+    ctrl = readval & 0x0300;
+    if (avc->max_gain_db >= 12)
+        ctrl |= 0x2000;
+    else if (avc->max_gain_db >= 6)
+        ctrl |= 0x1000;
+    if (avc->hard_limit)
+        ctrl |= 0x0020;
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_AVC_CTRL, ctrl | 0x0001);
+
+    if (ret == ESP_OK)
+        return ESP_OK;
+    else
+        return ESP_FAIL;
+}
+
+/*
+    DAP bass enhancement: synthesizes harmonics of the bass below cutoff_hz
+    so small speakers and headphones sound fuller.
+    cutoff_hz: 80 to 225 Hz, rounded to the codec's 25 Hz steps
+    lr_level, bass_level: 0.0 (lowest) to 1.0 (highest) mix levels of the
+    original signal and the generated bass
+*/
+esp_err_t audiosom32_dap_set_bass_enhance (uint8_t enable, uint16_t cutoff_hz, float lr_level, float bass_level)
+{
+    uint16_t cutoff;
+    esp_err_t ret = ESP_OK;
+
+    if (!enable)
+    {
+        if (audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_BASS_ENHANCE, 0x0000) == 0)
+            return ESP_OK;
+        else
+            return ESP_FAIL;
+    }
+
+    lr_level = (lr_level < 0) ? 0 : (lr_level > 1) ? 1 : lr_level;
+    bass_level = (bass_level < 0) ? 0 : (bass_level > 1) ? 1 : bass_level;
+
+    // CUTOFF 0-6: 80, 100, 125, 150, 175, 200, 225 Hz
+    if (cutoff_hz < 90)
+        cutoff = 0;
+    else if (cutoff_hz >= 225)
+        cutoff = 6;
+    else
+        cutoff = (cutoff_hz - 88) / 25 + 1;
+
+    // Levels count down from the register maximum, 0 is loudest
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_BASS_ENHANCE_CTRL,
+        ((0x3F - (uint16_t) (lr_level * 0x3F)) << 8) | (0x7F - (uint16_t) (bass_level * 0x7F)));
+    ret |= audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_DAP_BASS_ENHANCE, (cutoff << 4) | 0x0001);
+
+    if (ret == ESP_OK)
+        return ESP_OK;
+    else
+        return ESP_FAIL;
+}
+
 /*
  * Basic initialization for audio recording via LINE IN
  * LINE IN is also routed to headphones for listening live to LINE IN
@@ -334,8 +902,8 @@ esp_err_t audiosom32_record_init (void)
     retval = audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_SSS_CTRL, 0x0000);
     ESP_LOGI (TAG, "Attach I2S in to DAC, err_code: %d", retval);
 
-    // Unmute DAC, no volume ramp enabled
-    retval = audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ADCDAC_CTRL, 0x0000);
+    // Unmute DAC, linear volume ramp so DAC volume changes do not click
+    retval = audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ADCDAC_CTRL, 0x0200);
     ESP_LOGI (TAG, "Unmute DAC, err_code: %d", retval);
 
     // DAC volume is 0dB for both channels
@@ -408,8 +976,8 @@ esp_err_t audiosom32_playback_init (void)
     retval = audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_SSS_CTRL, 0x0010);
     ESP_LOGI (TAG, "Attach I2S in to DAC, err_code: %d", retval);
 
-    // Unmute DAC, no volume ramp enabled
-    retval = audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ADCDAC_CTRL, 0x0000);
+    // Unmute DAC, linear volume ramp so DAC volume changes do not click
+    retval = audiosom32_write_reg (AUDIOSOM32_I2C_NUM, SGTL5000_CHIP_ADCDAC_CTRL, 0x0200);
     ESP_LOGI (TAG, "Unmute DAC, err_code: %d", retval);
 
     // DAC volume is 0dB for both channels
@@ -544,6 +1112,24 @@ void audiosom32_i2c_init()
     i2c_driver_install(i2c_master_port, conf.mode, I2C_MASTER_RX_BUF_DISABLE, I2C_MASTER_TX_BUF_DISABLE, 0);
 }
 
+/*
+    Reinstall the I2S driver with different DMA buffering. The round trip latency
+    of a full-duplex stream is roughly (buf_count + 1) * buf_len frames, the default
+    AUDIOSOM32_DMA_BUF_COUNT x AUDIOSOM32_DMA_BUF_LEN is sized for throughput.
+    MCLK stops while the driver is reinstalled.
+*/
+esp_err_t audiosom32_i2s_set_dma (int buf_count, int buf_len)
+{
+    i2s_driver_uninstall (AUDIOSOM32_I2S_NUM);
+
+    audiosom32_i2s_config.dma_buf_count = buf_count;
+    audiosom32_i2s_config.dma_buf_len = buf_len;
+    if (i2s_driver_install (AUDIOSOM32_I2S_NUM, &audiosom32_i2s_config, 0, NULL) != ESP_OK)
+        return ESP_FAIL;
+
+    return i2s_set_pin (AUDIOSOM32_I2S_NUM, &audiosom32_pin_config);
+}
+
 void audiosom32_i2s_init ()
 {
     i2s_driver_install(AUDIOSOM32_I2S_NUM, &audiosom32_i2s_config, 0, NULL);
@@ -0,0 +1,428 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "xtensa/hal.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "biquad.h"
+#include "audiosom32_driver.h"
+#include "audio_pm.h"
+
+static const char *TAG = "biquad.c";
+
+// Fraction bits of the output fed back in the DF2T int kernel
+#define BIQUAD_DF2T_FRAC    12
+
+static const char *kernel_names[BIQUAD_KERNELS] =
+{
+    "DF1 int", "DF2T int", "DF1 float", "DF2T float"
+};
+
+static inline int16_t biquad_sat16 (int32_t v)
+{
+    return (v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : v;
+}
+
+/*
+    Direct Form I in Q2.30 with the output rounded. The rounding error of the
+    last two outputs goes back through the feedback coefficients (full error
+    feedback), so the recursion runs as if y had never been rounded and the
+    output error stays at the rounding itself, also for low frequency poles.
+    State per section: x1, x2, y1, y2 and the errors e1, e2 in Q.30.
+*/
+static void IRAM_ATTR biquad_df1_int (biquad_cascade_t *bq, int16_t *samples, size_t frames)
+{
+    int64_t acc;
+    int32_t x, y;
+    int64_t *st;
+    const int32_t *c;
+    size_t n;
+    int ch, s;
+
+    for (n = 0; n < frames; n++)
+    {
+        for (ch = 0; ch < 2; ch++)
+        {
+            x = samples[2 * n + ch];
+            for (s = 0; s < bq->sections; s++)
+            {
+                c = bq->coef.q[s];
+                st = bq->state.q[ch][s];
+
+                // 32 x 32 -> 64 bit products, the history and errors fit in 32 bits
+                acc = (int64_t) c[0] * x + (int64_t) c[1] * (int32_t) st[0] + (int64_t) c[2] * (int32_t) st[1]
+                    - (int64_t) c[3] * (int32_t) st[2] - (int64_t) c[4] * (int32_t) st[3]
+                    - (((int64_t) c[3] * (int32_t) st[4] + (int64_t) c[4] * (int32_t) st[5]) >> BIQUAD_Q);
+                y = (int32_t) ((acc + (1LL << (BIQUAD_Q - 1))) >> BIQUAD_Q);
+
+                st[5] = st[4];
+                st[4] = acc - ((int64_t) y << BIQUAD_Q);
+                st[1] = st[0];
+                st[0] = x;
+                st[3] = st[2];
+                st[2] = y;
+                x = y;
+            }
+            samples[2 * n + ch] = biquad_sat16 (x);
+        }
+    }
+}
+
+/*
+    Transposed Direct Form II, states kept in Q.30 so nothing is rounded
+    away between samples. Every shift rounds: truncation would bias each
+    step by half an LSB, and the recursion multiplies that by about
+    1 / (1 + a1 + a2), a DC offset of several LSB for low frequency poles.
+*/
+static void IRAM_ATTR biquad_df2t_int (biquad_cascade_t *bq, int16_t *samples, size_t frames)
+{
+    int64_t acc;
+    int32_t x, y, yf;
+    int64_t *st;
+    const int32_t *c;
+    size_t n;
+    int ch, s;
+
+    for (n = 0; n < frames; n++)
+    {
+        for (ch = 0; ch < 2; ch++)
+        {
+            x = samples[2 * n + ch];
+            for (s = 0; s < bq->sections; s++)
+            {
+                c = bq->coef.q[s];
+                st = bq->state.q[ch][s];
+
+                // Output with BIQUAD_DF2T_FRAC fraction bits for the feedback,
+                // an integer y would leave a dead band around low frequency poles
+                acc = (int64_t) c[0] * x + st[0];
+                yf = (int32_t) ((acc + (1LL << (BIQUAD_Q - BIQUAD_DF2T_FRAC - 1))) >> (BIQUAD_Q - BIQUAD_DF2T_FRAC));
+                y = (yf + (1 << (BIQUAD_DF2T_FRAC - 1))) >> BIQUAD_DF2T_FRAC;
+                st[0] = (int64_t) c[1] * x - (((int64_t) c[3] * yf + (1 << (BIQUAD_DF2T_FRAC - 1))) >> BIQUAD_DF2T_FRAC) + st[1];
+                st[1] = (int64_t) c[2] * x - (((int64_t) c[4] * yf + (1 << (BIQUAD_DF2T_FRAC - 1))) >> BIQUAD_DF2T_FRAC);
+                x = y;
+            }
+            samples[2 * n + ch] = biquad_sat16 (x);
+        }
+    }
+}
+
+static void IRAM_ATTR biquad_df1_float (biquad_cascade_t *bq, int16_t *samples, size_t frames)
+{
+    float x, y;
+    float *st;
+    const float *c;
+    size_t n;
+    int ch, s;
+
+    for (n = 0; n < frames; n++)
+    {
+        for (ch = 0; ch < 2; ch++)
+        {
+            x = samples[2 * n + ch];
+            for (s = 0; s < bq->sections; s++)
+            {
+                c = bq->coef.f[s];
+                st = bq->state.f[ch][s];
+
+                y = c[0] * x + c[1] * st[0] + c[2] * st[1] - c[3] * st[2] - c[4] * st[3];
+                st[1] = st[0];
+                st[0] = x;
+                st[3] = st[2];
+                st[2] = y;
+                x = y;
+            }
+            samples[2 * n + ch] = biquad_sat16 ((int32_t) lroundf (x));
+        }
+    }
+}
+
+static void IRAM_ATTR biquad_df2t_float (biquad_cascade_t *bq, int16_t *samples, size_t frames)
+{
+    float x, y;
+    float *st;
+    const float *c;
+    size_t n;
+    int ch, s;
+
+    for (n = 0; n < frames; n++)
+    {
+        for (ch = 0; ch < 2; ch++)
+        {
+            x = samples[2 * n + ch];
+            for (s = 0; s < bq->sections; s++)
+            {
+                c = bq->coef.f[s];
+                st = bq->state.f[ch][s];
+
+                y = c[0] * x + st[0];
+                st[0] = c[1] * x - c[3] * y + st[1];
+                st[1] = c[2] * x - c[4] * y;
+                x = y;
+            }
+            samples[2 * n + ch] = biquad_sat16 ((int32_t) lroundf (x));
+        }
+    }
+}
+
+/*
+    Biquad coefficients from the RBJ audio EQ cookbook formulas, as
+    { b0, b1, b2, a1, a2 } with a0 normalized to 1
+    freq: corner or center frequency in Hz, below sample_rate / 2
+    q: quality factor, 0.707 for Butterworth low/high pass and shelves
+    gain_db: boost/cut for peak and shelf filters, ignored otherwise
+    Shared by the kernels here and the codec's DAP (audiosom32_biquad_design ()).
+*/
+esp_err_t biquad_calc (biquad_type_t type, float freq, float q, float gain_db, uint32_t sample_rate, float coef[5])
+{
+    float w0, cosw, alpha, a, sqa;
+    float b0, b1, b2, a0, a1, a2;
+
+    if (freq <= 0 || freq >= sample_rate / 2.0f || q <= 0)
+        return ESP_ERR_INVALID_ARG;
+
+    w0 = 2 * (float) M_PI * freq / sample_rate;
+    cosw = cosf (w0);
+    alpha = sinf (w0) / (2 * q);
+    a = powf (10, gain_db / 40);
+    sqa = 2 * sqrtf (a) * alpha;
+
+    switch (type)
+    {
+        case BIQUAD_LOWPASS:
+            b0 = (1 - cosw) / 2;    b1 = 1 - cosw;      b2 = (1 - cosw) / 2;
+            a0 = 1 + alpha;         a1 = -2 * cosw;     a2 = 1 - alpha;
+            break;
+        case BIQUAD_HIGHPASS:
+            b0 = (1 + cosw) / 2;    b1 = -(1 + cosw);   b2 = (1 + cosw) / 2;
+            a0 = 1 + alpha;         a1 = -2 * cosw;     a2 = 1 - alpha;
+            break;
+        case BIQUAD_BANDPASS:
+            b0 = alpha;             b1 = 0;             b2 = -alpha;
+            a0 = 1 + alpha;         a1 = -2 * cosw;     a2 = 1 - alpha;
+            break;
+        case BIQUAD_NOTCH:
+            b0 = 1;                 b1 = -2 * cosw;     b2 = 1;
+            a0 = 1 + alpha;         a1 = -2 * cosw;     a2 = 1 - alpha;
+            break;
+        case BIQUAD_PEAK:
+            b0 = 1 + alpha * a;     b1 = -2 * cosw;     b2 = 1 - alpha * a;
+            a0 = 1 + alpha / a;     a1 = -2 * cosw;     a2 = 1 - alpha / a;
+            break;
+        case BIQUAD_LOWSHELF:
+            b0 = a * ((a + 1) - (a - 1) * cosw + sqa);
+            b1 = 2 * a * ((a - 1) - (a + 1) * cosw);
+            b2 = a * ((a + 1) - (a - 1) * cosw - sqa);
+            a0 = (a + 1) + (a - 1) * cosw + sqa;
+            a1 = -2 * ((a - 1) + (a + 1) * cosw);
+            a2 = (a + 1) + (a - 1) * cosw - sqa;
+            break;
+        case BIQUAD_HIGHSHELF:
+            b0 = a * ((a + 1) + (a - 1) * cosw + sqa);
+            b1 = -2 * a * ((a - 1) + (a + 1) * cosw);
+            b2 = a * ((a + 1) + (a - 1) * cosw - sqa);
+            a0 = (a + 1) - (a - 1) * cosw + sqa;
+            a1 = 2 * ((a - 1) - (a + 1) * cosw);
+            a2 = (a + 1) - (a - 1) * cosw - sqa;
+            break;
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+
+    coef[0] = b0 / a0;
+    coef[1] = b1 / a0;
+    coef[2] = b2 / a0;
+    coef[3] = a1 / a0;
+    coef[4] = a2 / a0;
+
+    return ESP_OK;
+}
+
+/*
+    Set up a cascade of sections, each { b0, b1, b2, a1, a2 } with a0
+    normalized to 1 (see biquad_calc ()). The int kernels need
+    every coefficient within +/-2.
+*/
+esp_err_t biquad_init (biquad_cascade_t *bq, biquad_kernel_t kernel, const float (*coefs)[5], int sections)
+{
+    int s, i;
+
+    if (kernel >= BIQUAD_KERNELS || sections < 1 || sections > BIQUAD_MAX_SECTIONS)
+        return ESP_ERR_INVALID_ARG;
+
+    for (s = 0; s < sections; s++)
+    {
+        for (i = 0; i < 5; i++)
+        {
+            if (kernel == BIQUAD_DF1_FLOAT || kernel == BIQUAD_DF2T_FLOAT)
+                bq->coef.f[s][i] = coefs[s][i];
+            else if (coefs[s][i] >= 2.0f || coefs[s][i] < -2.0f)
+                return ESP_ERR_INVALID_ARG;
+            else
+                bq->coef.q[s][i] = (int32_t) llroundf (coefs[s][i] * (float) (1LL << BIQUAD_Q));
+        }
+    }
+
+    bq->kernel = kernel;
+    bq->sections = sections;
+    biquad_reset (bq);
+
+    return ESP_OK;
+}
+
+/*
+    Clear the filter history, e.g. before a new stream
+*/
+void biquad_reset (biquad_cascade_t *bq)
+{
+    memset (&bq->state, 0, sizeof (bq->state));
+}
+
+/*
+    Filter interleaved 16-bit stereo in place. Same signature as a monitor
+    processing stage, arg is the biquad_cascade_t.
+*/
+void IRAM_ATTR biquad_process (int16_t *samples, size_t frames, void *arg)
+{
+    biquad_cascade_t *bq = arg;
+
+    switch (bq->kernel)
+    {
+        case BIQUAD_DF1_INT:
+            biquad_df1_int (bq, samples, frames);
+            break;
+        case BIQUAD_DF2T_INT:
+            biquad_df2t_int (bq, samples, frames);
+            break;
+        case BIQUAD_DF1_FLOAT:
+            biquad_df1_float (bq, samples, frames);
+            break;
+        case BIQUAD_DF2T_FLOAT:
+            biquad_df2t_float (bq, samples, frames);
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+    Run every kernel over the same noise with a BIQUAD_BENCH_SECTIONS cascade
+    (EQ-like mix of shelves and peaks) and log CPU cycles per sample and the
+    largest difference to DF1 float in LSBs. Runs at full CPU speed, on
+    whichever core the caller is on.
+*/
+esp_err_t biquad_bench_run (void)
+{
+    static const struct
+    {
+        biquad_type_t type;
+        float freq, q, gain_db;
+    } bench_eq[BIQUAD_BENCH_SECTIONS] =
+    {
+        { BIQUAD_HIGHPASS, 30, 0.707f, 0 },
+        { BIQUAD_LOWSHELF, 120, 0.707f, 4 },
+        { BIQUAD_PEAK, 2500, 1.5f, -3 },
+        { BIQUAD_HIGHSHELF, 8000, 0.707f, 2 },
+    };
+    float coefs[BIQUAD_BENCH_SECTIONS][5];
+    biquad_cascade_t *bq;
+    int16_t *input, *ref, *work;
+    uint32_t start, cycles, samples;
+    int32_t diff, max_diff;
+    int k, b, i;
+
+    for (i = 0; i < BIQUAD_BENCH_SECTIONS; i++)
+        biquad_calc (bench_eq[i].type, bench_eq[i].freq, bench_eq[i].q, bench_eq[i].gain_db, AUDIOSOM32_SAMPLERATE, coefs[i]);
+
+    bq = heap_caps_malloc (sizeof (biquad_cascade_t), MALLOC_CAP_8BIT);
+    input = heap_caps_malloc (BIQUAD_BENCH_FRAMES * 4 * BIQUAD_BENCH_BLOCKS, MALLOC_CAP_8BIT);
+    ref = heap_caps_malloc (BIQUAD_BENCH_FRAMES * 4 * BIQUAD_BENCH_BLOCKS, MALLOC_CAP_8BIT);
+    work = heap_caps_malloc (BIQUAD_BENCH_FRAMES * 4, MALLOC_CAP_8BIT);
+    if (bq == NULL || input == NULL || ref == NULL || work == NULL)
+    {
+        ESP_LOGE (TAG, "Not enough memory for the biquad benchmark");
+        free (bq);
+        free (input);
+        free (ref);
+        free (work);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // -12 dBFS white noise, same for every kernel
+    srand (1);
+    for (i = 0; i < BIQUAD_BENCH_FRAMES * 2 * BIQUAD_BENCH_BLOCKS; i++)
+        input[i] = (rand () % 16384) - 8192;
+
+    audio_pm_work_begin ();
+    ESP_LOGI (TAG, "%d sections, %d frame blocks:", BIQUAD_BENCH_SECTIONS, BIQUAD_BENCH_FRAMES);
+
+    // DF1 float first, it is the reference for the others
+    for (k = BIQUAD_DF1_FLOAT; k < BIQUAD_DF1_FLOAT + BIQUAD_KERNELS; k++)
+    {
+        biquad_init (bq, k % BIQUAD_KERNELS, coefs, BIQUAD_BENCH_SECTIONS);
+        cycles = 0;
+        max_diff = 0;
+
+        for (b = 0; b < BIQUAD_BENCH_BLOCKS; b++)
+        {
+            memcpy (work, input + b * BIQUAD_BENCH_FRAMES * 2, BIQUAD_BENCH_FRAMES * 4);
+            start = xthal_get_ccount ();
+            biquad_process (work, BIQUAD_BENCH_FRAMES, bq);
+            cycles += xthal_get_ccount () - start;
+
+            if (k == BIQUAD_DF1_FLOAT)
+                memcpy (ref + b * BIQUAD_BENCH_FRAMES * 2, work, BIQUAD_BENCH_FRAMES * 4);
+            else
+            {
+                for (i = 0; i < BIQUAD_BENCH_FRAMES * 2; i++)
+                {
+                    diff = abs (work[i] - ref[b * BIQUAD_BENCH_FRAMES * 2 + i]);
+                    if (diff > max_diff)
+                        max_diff = diff;
+                }
+            }
+        }
+
+        samples = BIQUAD_BENCH_FRAMES * 2 * BIQUAD_BENCH_BLOCKS;
+        ESP_LOGI (TAG, "%-10s %d.%02d cycles/sample, %d per section, max diff %d LSB", kernel_names[k % BIQUAD_KERNELS],
+            cycles / samples, (cycles % samples) * 100 / samples, cycles / samples / BIQUAD_BENCH_SECTIONS, max_diff);
+    }
+    audio_pm_work_end ();
+
+    free (bq);
+    free (input);
+    free (ref);
+    free (work);
+
+    return ESP_OK;
+}
@@ -0,0 +1,60 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _DITHER_H_
+#define _DITHER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+typedef enum
+{
+    DITHER_ROUND = 0,               // Plain rounding, distortion correlated with the signal
+    DITHER_TPDF,                    // +-1 LSB triangular dither, flat noise floor
+    DITHER_TPDF_SHAPED1,            // TPDF, noise pushed up in frequency by (1 - z^-1)
+    DITHER_TPDF_SHAPED2,            // TPDF, noise pushed up in frequency by (1 - z^-1)^2
+    DITHER_MODES
+} dither_mode_t;
+
+// Error fed back by the noise shaper is limited to this, in 1/256 LSB,
+// so clipping at full scale cannot make it run away
+#define DITHER_ERROR_LIMIT          (16*256)
+// Compare all modes at boot (1) or never (0)
+#define DITHER_BENCH_AT_BOOT        0
+#define DITHER_BENCH_FRAMES         512
+#define DITHER_BENCH_BLOCKS         64
+
+typedef struct
+{
+    dither_mode_t mode;
+    uint32_t seed;                  // xorshift32 state
+    int32_t err[2][2];              // Last two errors per channel, 1/256 LSB
+} dither_t;
+
+void dither_init (dither_t *dt, dither_mode_t mode);
+void dither_process (dither_t *dt, const int32_t *in, int16_t *out, size_t frames);
+esp_err_t dither_bench_run (void);
+
+#endif
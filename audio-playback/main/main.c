@@ -35,41 +35,28 @@ software.
 #include "main.h"
 #include "audiosom32_driver.h"
 #include "sounds.h"
+#include "profiler.h"
+#include "audio_pm.h"
+#include "player.h"
+#include "audio_mem.h"
+#include "biquad.h"
+#include "dither.h"
+#include "volume.h"
 
 static const char *TAG = "main.c";
 
-void audio_play_task (void *pvParameter)
+void app_main()
 {
-    const char *ptr = (const char *)audiobit_music;
-    unsigned int offset = 0;
-    signed short samples[256], i;
-    size_t written;
-
-    // Play array from signed, 16-bit stereo file
-    while (offset<NUM_ELEMENTS*2)
-    {
-        memcpy (samples, ptr+offset, sizeof(samples));
+    // All audio buffers come from one arena, allocate it before anything else
+    if (audio_mem_init () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to allocate audio memory arena!");
 
-        for (i=0; i<256; i++)
-            samples[i] = samples[i] + 32768;
-        i2s_write (AUDIOSOM32_I2S_NUM, (const char*) samples, 512, &written, portMAX_DELAY);
-        offset = offset+512;
-    }
-
-    ESP_LOGW (TAG, "Done playing demo file. Reset to re-play!\n");
+    // Dynamic frequency scaling, CPU runs at max only while audio work is pending
+    if (audio_pm_init (AUDIO_PM_DEFAULT_MODE) != ESP_OK)
+        ESP_LOGE (TAG, "Failed to configure power management!");
 
-    // Silence here
-    while (1)
-    {
-        for (i=0; i<256; i++)
-            samples[i] = 0;
-        i2s_write (AUDIOSOM32_I2S_NUM, (const char*) samples, 512, &written, portMAX_DELAY);
-    }
-}
-
-void app_main()
-{
     // Initialize the I2S clocks
+    audio_pm_stream_start ();
     audiosom32_i2s_init ();
     // Wait for MCLK to stabilize
     ets_delay_us (1000);
@@ -81,7 +68,62 @@ void app_main()
     else
         ESP_LOGI (TAG, "Seems like AudioSOM32 is not connected configured!\n");
 
+    // Cycles per sample of the DSP kernels, to choose what runs on the CPU
+    if (BIQUAD_BENCH_AT_BOOT && biquad_bench_run () != ESP_OK)
+        ESP_LOGE (TAG, "Biquad benchmark failed!");
+    if (DITHER_BENCH_AT_BOOT && dither_bench_run () != ESP_OK)
+        ESP_LOGE (TAG, "Dither benchmark failed!");
+
+    // I2S in -> DAP -> DAC, tone shaping and dynamics cost no ESP32 cycles
+    if (PLAYER_DAP_EQ || PLAYER_DAP_AVC)
+    {
+        audiosom32_biquad_t eq[2];
+        audiosom32_avc_t avc =
+        {
+            .threshold_db = -12,
+            .max_gain_db = 6,
+            .attack_ms = 50,
+            .decay_ms = 2000,
+            .hard_limit = 0
+        };
+        esp_err_t ret = ESP_OK;
+
+        // Low shelf +4 dB, high shelf -2 dB
+        if (PLAYER_DAP_EQ)
+        {
+            audiosom32_biquad_design (BIQUAD_LOWSHELF, 120, 0.707f, 4, &eq[0]);
+            audiosom32_biquad_design (BIQUAD_HIGHSHELF, 8000, 0.707f, -2, &eq[1]);
+            ret |= audiosom32_dap_set_eq (eq, 2);
+        }
+        if (PLAYER_DAP_AVC)
+        {
+            ret |= audiosom32_dap_set_avc (&avc);
+            ret |= audiosom32_dap_set_bass_enhance (1, 125, 1.0f, 0.75f);
+        }
+        ret |= audiosom32_dap_route (AUDIOSOM32_DAP_PLAYBACK);
+        if (ret != ESP_OK)
+            ESP_LOGE (TAG, "Failed to set up the DAP!");
+    }
+
+    // Fade the DAC in from the volume task, audio_play_task never waits on I2C
+    if (volume_init () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to start volume control!");
+    else
+    {
+        volume_set (AUDIOSOM32_VOLUME_DAC, AUDIOSOM32_DAC_VOL_MIN_DB);
+        volume_fade (AUDIOSOM32_VOLUME_DAC, 0, PLAYER_FADE_IN_MS, VOLUME_CURVE_SMOOTH);
+    }
+
     // Create a task to play audio by loading DMA buffers
     // Not loading in time may cause muting or glitches
+    if (player_init () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to create playback queue!");
+
+    // Play the demo clip once, the player parks the output when it ends
+    player_queue_clip (audiobit_music, NUM_ELEMENTS*2);
     xTaskCreate(&audio_play_task, "audio_play_task", 4096, NULL, 8, NULL);
+
+    // Periodic CPU load, stack and heap report
+    if (profiler_start () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to start profiler!");
 }
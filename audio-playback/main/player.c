@@ -0,0 +1,170 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "main.h"
+#include "audiosom32_driver.h"
+#include "player.h"
+#include "profiler.h"
+#include "audio_pm.h"
+#include "audio_mem.h"
+
+static const char *TAG = "player.c";
+
+typedef struct
+{
+    const uint8_t *data;
+    uint32_t len;
+} player_clip_t;
+
+static QueueHandle_t play_queue = NULL;
+
+esp_err_t player_init (void)
+{
+    play_queue = xQueueCreate (PLAYER_QUEUE_LEN, sizeof (player_clip_t));
+    if (play_queue == NULL)
+        return ESP_FAIL;
+
+    return ESP_OK;
+}
+
+/*
+    Queue raw signed 16-bit stereo data for playback.
+    The data must stay valid until it has been played.
+    A parked player wakes up and resumes output right away.
+*/
+esp_err_t player_queue_clip (const void *data, uint32_t len)
+{
+    player_clip_t clip =
+    {
+        .data = data,
+        .len = len
+    };
+
+    if (play_queue == NULL)
+        return ESP_FAIL;
+
+    if (xQueueSend (play_queue, &clip, 0) != pdTRUE)
+        return ESP_FAIL;
+
+    return ESP_OK;
+}
+
+/*
+    Nothing more to play: let the DMA ring drain, silence it and stop
+    clocking the codec so the CPU (and in low power mode, the chip) can idle.
+    The ring is zeroed before the DAC powers down, otherwise the DMA keeps
+    looping the last buffers into the DAC while its mute ramps down.
+*/
+static void player_park (void)
+{
+    // Everything already written is still in the DMA ring, let it play out
+    vTaskDelay ((AUDIOSOM32_DMA_BUF_COUNT*AUDIOSOM32_DMA_BUF_LEN*1000/AUDIOSOM32_SAMPLERATE)/portTICK_RATE_MS + 1);
+    i2s_zero_dma_buffer (AUDIOSOM32_I2S_NUM);
+
+#if PLAYER_PARK_OUTPUT
+    // The codec still needs MCLK for I2C access, so before i2s_stop ()
+    if (audiosom32_power_down_output () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to power down DAC/HP!");
+#endif
+    i2s_stop (AUDIOSOM32_I2S_NUM);
+    audio_pm_stream_stop ();
+
+    ESP_LOGW (TAG, "Playback idle, output parked");
+    profiler_dump ();
+    audio_pm_report ();
+}
+
+static void player_resume (void)
+{
+    audio_pm_stream_start ();
+    i2s_start (AUDIOSOM32_I2S_NUM);
+#if PLAYER_PARK_OUTPUT
+    if (audiosom32_power_up_output () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to power up DAC/HP!");
+#endif
+    ESP_LOGI (TAG, "Playback resumed");
+}
+
+void audio_play_task (void *pvParameter)
+{
+    player_clip_t clip;
+    uint32_t offset, len;
+    signed short *samples;
+    unsigned int i;
+    size_t written;
+    bool parked = false;
+
+    // Block buffer comes from the audio arena instead of the task stack
+    samples = audio_mem_alloc (AUDIO_POOL_PLAYBACK, PLAYER_BLOCK_SIZE);
+    if (samples == NULL)
+    {
+        ESP_LOGE (TAG, "No playback buffer, player stopped!");
+        vTaskDelete (NULL);
+    }
+    audio_mem_report ();
+
+    while (1)
+    {
+        // Block while parked, otherwise park as soon as the queue runs dry
+        if (xQueueReceive (play_queue, &clip, parked ? portMAX_DELAY : 0) != pdTRUE)
+        {
+            player_park ();
+            parked = true;
+            continue;
+        }
+
+        if (parked)
+        {
+            player_resume ();
+            parked = false;
+        }
+
+        // Play array from signed, 16-bit stereo data
+        for (offset = 0; offset < clip.len; offset += len)
+        {
+            len = clip.len - offset;
+            if (len > PLAYER_BLOCK_SIZE)
+                len = PLAYER_BLOCK_SIZE;
+
+            // Full speed only while the block is prepared, i2s_write mostly blocks
+            audio_pm_work_begin ();
+            memcpy (samples, clip.data + offset, len);
+
+            for (i=0; i<len/2; i++)
+                samples[i] = samples[i] + 32768;
+            audio_pm_work_end ();
+            i2s_write (AUDIOSOM32_I2S_NUM, (const char*) samples, len, &written, portMAX_DELAY);
+        }
+    }
+}
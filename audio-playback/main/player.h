@@ -0,0 +1,47 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _PLAYER_H_
+#define _PLAYER_H_
+
+#include "esp_err.h"
+// PLAYER_BLOCK_SIZE
+#include "audio_mem_config.h"
+
+// Number of clips that can wait for playback
+#define PLAYER_QUEUE_LEN            4
+// Power down DAC and HP amplifier while the player is parked (1) or keep them powered (0)
+#define PLAYER_PARK_OUTPUT          1
+// Bass/treble shaping by the codec DAP (1), costs no ESP32 cycles, or none (0)
+#define PLAYER_DAP_EQ               0
+// Level the output with the codec AVC and bass enhancement (1), or none (0)
+#define PLAYER_DAP_AVC              0
+// DAC volume fades in over this long at boot
+#define PLAYER_FADE_IN_MS           300
+
+esp_err_t player_init (void);
+esp_err_t player_queue_clip (const void *data, uint32_t len);
+void audio_play_task (void *pvParameter);
+
+#endif
@@ -0,0 +1,41 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include "esp_err.h"
+
+// Period of the one-line load summary in milliseconds, 0 disables the periodic log
+#define PROFILER_INTERVAL_MS        10000
+// Maximum number of tasks tracked between two samples
+#define PROFILER_MAX_TASKS          24
+// Stack size and priority of the profiler task itself
+#define PROFILER_TASK_STACK         3072
+#define PROFILER_TASK_PRIO          1
+
+esp_err_t profiler_start (void);
+void profiler_dump (void);
+
+#endif
@@ -0,0 +1,289 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "agc.h"
+#include "audiosom32_driver.h"
+
+static const char *TAG = "agc.c";
+
+// Fine gain is Q2.14, 1.0 = 16384
+#define AGC_GAIN_Q                  14
+
+// Mic preamp gain steps (audiosom32_set_mic_gain () 0 to 3)
+static const float mic_steps[] = { 0, 20, 30, 40 };
+#define AGC_MIC_STEPS               (sizeof (mic_steps) / sizeof (mic_steps[0]))
+
+// Input level since the last control interval, filled by agc_process ()
+static portMUX_TYPE agc_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t acc_peak = 0;
+static uint64_t acc_sum_sq = 0;
+static uint32_t acc_samples = 0;
+
+static volatile int32_t fine_target = 1 << AGC_GAIN_Q;
+static int32_t fine_gain = 1 << AGC_GAIN_Q;         // Owned by agc_process ()
+
+static audiosom32_capture_t agc_capture;            // Input settings, gain fields owned by the AGC task
+static bool agc_mic = false;
+static volatile int8_t agc_new_source = -1;         // Input change for the AGC task, -1 if none
+static bool agc_running = false;
+static float analog_db = AGC_START_DB;              // Mic preamp + ADC volume
+static float fine_db = 0;
+static float total_db = AGC_START_DB;               // Gain the AGC wants
+static uint8_t mic_step = 0;
+static uint32_t analog_writes = 0;
+static uint32_t clip_events = 0;
+
+/*
+    Mic preamp step for an analog gain, the rest is ADC volume. More preamp
+    gain is preferred, it adds less noise than ADC gain.
+*/
+static uint8_t agc_mic_step (float db)
+{
+    int i;
+
+    if (agc_mic)
+        for (i = AGC_MIC_STEPS - 1; i > 0; i--)
+            if (db - mic_steps[i] >= AUDIOSOM32_ADC_VOL_MIN_DB)
+                return i;
+    return 0;
+}
+
+static float agc_analog_max (void)
+{
+    return AUDIOSOM32_ADC_VOL_MAX_DB + (agc_mic ? mic_steps[AGC_MIC_STEPS - 1] : 0);
+}
+
+/*
+    Nearest analog gain the codec can do. The mic preamp steps are not on
+    the ADC volume grid, so the preamp step is picked first and only the
+    ADC part is rounded. The step goes to *step.
+*/
+static float agc_analog_round (float db, uint8_t *step)
+{
+    float adc;
+
+    *step = agc_mic_step (db);
+    adc = roundf ((db - mic_steps[*step]) / AUDIOSOM32_ADC_VOL_STEP_DB) * AUDIOSOM32_ADC_VOL_STEP_DB;
+    adc = fminf (fmaxf (adc, AUDIOSOM32_ADC_VOL_MIN_DB), AUDIOSOM32_ADC_VOL_MAX_DB);
+    return mic_steps[*step] + adc;
+}
+
+/*
+    Split an analog gain into mic preamp and ADC volume and write them,
+    analog_db is set to the gain written. Both orders of writing only pass
+    through a lower total gain.
+*/
+static esp_err_t agc_set_analog (float db)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t step;
+
+    db = agc_analog_round (db, &step);
+    if (step > mic_step)
+    {
+        ret |= audiosom32_set_adc_volume (db - mic_steps[step]);
+        ret |= audiosom32_set_mic_gain (step);
+    }
+    else
+    {
+        if (step < mic_step)
+            ret |= audiosom32_set_mic_gain (step);
+        ret |= audiosom32_set_adc_volume (db - mic_steps[step]);
+    }
+    mic_step = step;
+    analog_db = db;
+    analog_writes++;
+
+    return ret;
+}
+
+/*
+    Measures the input and applies the digital fine gain to a block of
+    interleaved samples, in place. The gain ramps to its new value over the
+    block so there is no step. Runs in the recorder task, never blocks.
+*/
+void IRAM_ATTR agc_process (int16_t *samples, size_t frames, void *arg)
+{
+    size_t i, n = frames * 2;
+    int32_t x, gain, step;
+    uint32_t peak = 0, mag;
+    uint64_t sum_sq = 0;
+
+    if (n == 0)
+        return;
+
+    gain = fine_gain;
+    step = (fine_target - gain) / (int32_t) n;
+    for (i = 0; i < n; i++)
+    {
+        x = samples[i];
+        sum_sq += (uint32_t) (x * x);
+        mag = x < 0 ? -x : x;
+        peak = mag > peak ? mag : peak;
+
+        gain += step;
+        x = (x * gain) >> AGC_GAIN_Q;
+        samples[i] = x > 32767 ? 32767 : (x < -32768 ? -32768 : x);
+    }
+    fine_gain = gain;
+
+    portENTER_CRITICAL (&agc_lock);
+    acc_peak = peak > acc_peak ? peak : acc_peak;
+    acc_sum_sq += sum_sq;
+    acc_samples += n;
+    portEXIT_CRITICAL (&agc_lock);
+}
+
+/*
+    Control loop: level -> wanted gain -> analog part (with hysteresis) and
+    digital fine part. Only this task talks to the codec.
+*/
+static void agc_task (void *pvParameter)
+{
+    uint32_t peak, samples;
+    uint64_t sum_sq;
+    float peak_db, rms_db, err;
+    uint8_t step;
+    float max_up = AGC_RELEASE_DB_S * AGC_INTERVAL_MS / 1000;
+    float max_down = AGC_ATTACK_DB_S * AGC_INTERVAL_MS / 1000;
+    TickType_t last = xTaskGetTickCount ();
+
+    while (1)
+    {
+        vTaskDelayUntil (&last, AGC_INTERVAL_MS/portTICK_RATE_MS);
+
+        portENTER_CRITICAL (&agc_lock);
+        peak = acc_peak;
+        sum_sq = acc_sum_sq;
+        samples = acc_samples;
+        acc_peak = 0;
+        acc_sum_sq = 0;
+        acc_samples = 0;
+        portEXIT_CRITICAL (&agc_lock);
+
+        // Input switched: written here with the current analog gain, split
+        // for the new input, so the switch never undoes a gain change
+        if (agc_new_source >= 0)
+        {
+            agc_capture.source = agc_new_source;
+            agc_new_source = -1;
+            agc_mic = agc_capture.source == AUDIOSOM32_INPUT_MIC;
+            analog_db = agc_analog_round (analog_db, &mic_step);
+            total_db = analog_db + fine_db;
+            agc_capture.mic_gain = mic_step;
+            agc_capture.adc_db = analog_db - mic_steps[mic_step];
+            if (audiosom32_set_capture (&agc_capture) != ESP_OK)
+                ESP_LOGE (TAG, "Failed to switch the input!");
+            analog_writes++;
+        }
+
+        // Nothing recorded in this interval
+        if (samples == 0)
+            continue;
+
+        // Levels at the ADC output, before the fine gain
+        peak_db = peak ? 20 * log10f (peak / 32768.0f) : -96;
+        rms_db = sum_sq ? 10 * log10f ((float) sum_sq / samples / (32768.0f * 32768.0f)) : -96;
+
+        if (peak_db > AGC_CLIP_DB)
+        {
+            // ADC clipped, the fine gain cannot undo that
+            total_db -= AGC_CLIP_DROP_DB;
+            clip_events++;
+        }
+        else if (rms_db > AGC_GATE_DB)
+        {
+            err = AGC_TARGET_DB - (peak_db + fine_db);
+            total_db += fminf (fmaxf (err, -max_down), max_up);
+        }
+        total_db = fminf (fmaxf (total_db, AUDIOSOM32_ADC_VOL_MIN_DB - AGC_FINE_RANGE_DB),
+                          agc_analog_max () + AGC_FINE_RANGE_DB);
+
+        // Analog gain moves only when the fine gain runs out of range
+        if (fabsf (total_db - analog_db) > AGC_FINE_RANGE_DB || peak_db > AGC_CLIP_DB)
+        {
+            if (agc_analog_round (total_db, &step) != analog_db && agc_set_analog (total_db) != ESP_OK)
+                ESP_LOGE (TAG, "Failed to set analog gain!");
+        }
+
+        fine_db = fminf (fmaxf (total_db - analog_db, -AGC_FINE_RANGE_DB), AGC_FINE_RANGE_DB);
+        fine_target = (int32_t) (powf (10, fine_db / 20) * (1 << AGC_GAIN_Q));
+    }
+}
+
+/*
+    Start the AGC on the input set up by audiosom32_set_capture (capture).
+    With the mic the preamp is part of the analog gain, with line in only
+    the ADC volume is. From here on the AGC owns the gain fields.
+*/
+esp_err_t agc_start (const audiosom32_capture_t *capture)
+{
+    if (agc_running)
+        return ESP_OK;
+
+    agc_capture = *capture;
+    agc_mic = capture->source == AUDIOSOM32_INPUT_MIC;
+    mic_step = agc_mic ? AGC_MIC_STEPS - 1 : 0;
+    if (agc_set_analog (AGC_START_DB) != ESP_OK)
+        return ESP_FAIL;
+    total_db = analog_db;
+
+    if (xTaskCreate (&agc_task, "agc_task", AGC_TASK_STACK, NULL, AGC_TASK_PRIO, NULL) != pdPASS)
+        return ESP_FAIL;
+
+    agc_running = true;
+    return ESP_OK;
+}
+
+/*
+    Switch the capture input from the AGC task at its next interval, so
+    only that task writes the gain registers. ESP_ERR_INVALID_STATE if the
+    AGC is not running, then audiosom32_set_capture () can be used directly.
+*/
+esp_err_t agc_set_input (audiosom32_input_t source)
+{
+    if (!agc_running)
+        return ESP_ERR_INVALID_STATE;
+
+    agc_new_source = source;
+    return ESP_OK;
+}
+
+void agc_report (void)
+{
+    ESP_LOGI (TAG, "Gain %.1f dB: analog %.1f dB (mic preamp %d dB), fine %.1f dB",
+        analog_db + fine_db, analog_db, (int) mic_steps[mic_step], fine_db);
+    ESP_LOGI (TAG, "%d analog gain changes, %d ADC clip events", analog_writes, clip_events);
+}
@@ -0,0 +1,59 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _AGC_H_
+#define _AGC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "audiosom32_driver.h"
+
+// Peak level the AGC aims for, dBFS
+#define AGC_TARGET_DB               -12.0f
+// Below this RMS level the input is treated as silence and the gain is held
+#define AGC_GATE_DB                 -55.0f
+// A peak above this means the ADC clipped, the analog gain drops by AGC_CLIP_DROP_DB at once
+#define AGC_CLIP_DB                 -1.0f
+#define AGC_CLIP_DROP_DB            6.0f
+// Fastest gain changes, down and up
+#define AGC_ATTACK_DB_S             40.0f
+#define AGC_RELEASE_DB_S            3.0f
+// Digital fine gain range. The analog gain only moves once the fine gain
+// would leave it, which is the hysteresis that keeps analog writes rare
+#define AGC_FINE_RANGE_DB           3.0f
+// Analog gain the AGC starts from, dB (mic preamp + ADC volume)
+#define AGC_START_DB                0.0f
+// Control interval, levels are measured over it
+#define AGC_INTERVAL_MS             100
+#define AGC_TASK_STACK              2048
+#define AGC_TASK_PRIO               3           // Below every audio task
+
+esp_err_t agc_start (const audiosom32_capture_t *capture);
+esp_err_t agc_set_input (audiosom32_input_t source);
+void agc_process (int16_t *samples, size_t frames, void *arg);
+void agc_report (void);
+
+#endif
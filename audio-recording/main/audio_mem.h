@@ -0,0 +1,62 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _AUDIO_MEM_H_
+#define _AUDIO_MEM_H_
+
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_err.h"
+#include "audio_mem_config.h"
+
+typedef enum
+{
+    AUDIO_POOL_CAPTURE = 0,         // Blocks read from I2S
+    AUDIO_POOL_PLAYBACK,            // Blocks written to I2S
+    AUDIO_POOL_RING,                // Buffering between audio and storage tasks
+    AUDIO_POOL_ENCODER,             // Encoder/DSP state and scratch buffers
+    AUDIO_POOL_MAX
+} audio_pool_t;
+
+// Pool sizes (AUDIO_MEM_*_SIZE) are in audio_mem_config.h
+
+// Fixed-size blocks carved from a pool, handed between tasks by pointer
+typedef struct
+{
+    QueueHandle_t free;             // Pointers to free blocks
+    size_t block_size;
+    uint32_t count;
+    uint32_t min_free;              // Lowest number of free blocks seen
+} audio_block_pool_t;
+
+esp_err_t audio_mem_init (void);
+void *audio_mem_alloc (audio_pool_t pool, size_t size);
+void audio_mem_reset (audio_pool_t pool);
+void audio_mem_report (void);
+esp_err_t audio_block_pool_init (audio_block_pool_t *bp, audio_pool_t pool, size_t block_size, uint32_t count);
+void *audio_block_get (audio_block_pool_t *bp, TickType_t wait);
+void audio_block_put (audio_block_pool_t *bp, void *block);
+
+#endif
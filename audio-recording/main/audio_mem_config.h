@@ -0,0 +1,83 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+
+#ifndef _AUDIO_MEM_CONFIG_H_
+#define _AUDIO_MEM_CONFIG_H_
+
+/*
+    Settings of the modules that carve blocks from the audio arena, and the
+    pool sizes built from them. The module headers and audio_mem.h include
+    this, it includes nothing, so the sizes do not depend on include order.
+*/
+
+// Recorder (recorder.h)
+// Bytes read from I2S and written to the SD card at once
+#define REC_BLOCK_SIZE      2048
+// Capture blocks in flight between I2S and the SD card
+#define REC_BLOCK_COUNT     8
+// Capture pool, with room for the VAD pre-roll on top (AUDIO_MEM_CAPTURE_SIZE below)
+#define REC_POOL_BLOCKS     (REC_BLOCK_COUNT + (REC_VAD ? VAD_PREROLL_BLOCKS : 0))
+
+// Only write active regions of a recording (voice activity detection, see vad.h),
+// listed with their times in REC_VAD_SIDECAR. Not used for raw or overdub recordings.
+// Off by default, REC.WAV then has gaps wherever the input was silent
+#define REC_VAD             0
+
+// Also write a 16 kHz mono copy of the recording (mid of both channels, or the
+// channel REC_CHANNELS keeps, see decim.h) for speech processing. With REC_VAD
+// it has the same regions as REC.WAV. Not written in raw mode
+#define REC_VOICE           1
+// Voice track blocks in flight to the SD card (AUDIO_MEM_RING_SIZE below)
+#define REC_VOICE_BLOCK_SIZE    1024
+#define REC_VOICE_BLOCK_COUNT   4
+
+// Voice activity detection (vad.h)
+// Silent blocks held back and written in front of each active region,
+// so the onset is not lost. The capture pool is this many blocks bigger
+// (REC_POOL_BLOCKS), so the pre-roll does not eat into the SD card headroom
+#define VAD_PREROLL_BLOCKS          4
+
+// Monitoring (monitor.h)
+// 1: headphones hear I2S in -> processing -> I2S out (full-duplex)
+// 0: headphones hear the codec's analog line in bypass, nothing can be applied
+#define MONITOR_ENABLE              1
+// Frames per block, and per I2S DMA buffer. Smaller is lower latency but more interrupts
+#define MONITOR_BLOCK_FRAMES        32
+// Stereo 16-bit frames
+#define MONITOR_FRAME_BYTES         4
+#define MONITOR_BLOCK_BYTES         (MONITOR_BLOCK_FRAMES * MONITOR_FRAME_BYTES)
+
+// Overdub (overdub.h)
+// Blocks of the backing track read ahead of playback
+#define OVERDUB_BLOCK_SIZE          2048
+#define OVERDUB_BLOCK_COUNT         8
+
+// Pool sizes in bytes, the arena is the sum of all pools (each rounded up to 4 bytes)
+#define AUDIO_MEM_CAPTURE_SIZE      (REC_BLOCK_SIZE * REC_POOL_BLOCKS + (MONITOR_ENABLE ? MONITOR_BLOCK_BYTES : 0))
+#define AUDIO_MEM_PLAYBACK_SIZE     (MONITOR_ENABLE ? OVERDUB_BLOCK_SIZE * OVERDUB_BLOCK_COUNT : 0)
+#define AUDIO_MEM_RING_SIZE         (REC_VOICE ? REC_VOICE_BLOCK_SIZE * REC_VOICE_BLOCK_COUNT : 0)
+#define AUDIO_MEM_ENCODER_SIZE      0
+
+#endif
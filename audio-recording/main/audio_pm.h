@@ -0,0 +1,55 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _AUDIO_PM_H_
+#define _AUDIO_PM_H_
+
+#include "esp_err.h"
+
+typedef enum
+{
+    AUDIO_PM_PERFORMANCE = 0,       // CPU fixed at CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ
+    AUDIO_PM_BALANCED,              // CPU drops to 80 MHz whenever no audio work is pending
+    AUDIO_PM_LOW_POWER,             // As balanced, plus automatic light sleep while the I2S path is parked
+} audio_pm_mode_t;
+
+// Mode selected by the examples at boot
+#define AUDIO_PM_DEFAULT_MODE       AUDIO_PM_BALANCED
+// Lowest CPU frequency used by dynamic frequency scaling (must be 80 MHz or more while I2S runs)
+#define AUDIO_PM_MIN_FREQ_MHZ       80
+
+// Typical ESP32 supply current (0.1 mA units, dual core, radio off) used to
+// estimate savings, taken from the ESP32 datasheet. Measure your board for real numbers!
+#define AUDIO_PM_CURRENT_MAX_FREQ   360         // CPU at 160 MHz
+#define AUDIO_PM_CURRENT_MIN_FREQ   255         // CPU at 80 MHz
+#define AUDIO_PM_CURRENT_SLEEP      8           // Light sleep
+
+esp_err_t audio_pm_init (audio_pm_mode_t mode);
+void audio_pm_stream_start (void);
+void audio_pm_stream_stop (void);
+void audio_pm_work_begin (void);
+void audio_pm_work_end (void);
+void audio_pm_report (void);
+
+#endif
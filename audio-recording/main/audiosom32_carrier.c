@@ -23,7 +23,11 @@ software.
 */
 
 #include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "soc/rtc.h"
 #include "soc/soc.h"
 #include "esp_vfs_fat.h"
@@ -38,6 +42,24 @@ software.
 
 static const char *TAG = "audiosom32_carrier.c";
 
+typedef struct
+{
+    const char *name;
+    uint8_t width;
+    int freq_khz;
+} as32_sd_bus_mode_t;
+
+// Tried in this order until one mounts and passes the read back check
+static const as32_sd_bus_mode_t sd_bus_modes[] =
+{
+    { "4-bit high speed",       4, SDMMC_FREQ_HIGHSPEED },
+    { "4-bit default speed",    4, SDMMC_FREQ_DEFAULT },
+    { "1-bit default speed",    1, SDMMC_FREQ_DEFAULT },
+};
+
+static sdmmc_card_t *sd_card = NULL;
+static int sd_mode = -1;
+
 // Weak default button interrupt handler, declare this elsewhere to replace this function
 __attribute__((weak)) void IRAM_ATTR as32_btn_isr_handler(void* arg)
 {
@@ -67,11 +89,56 @@ void audiosom32_carrier_init (void)
     gpio_isr_handler_add(AS32_BTN_GPIO, as32_btn_isr_handler, (void*) AS32_BTN_GPIO);
 }
 
+/*
+    Check the bus by writing a pattern through the filesystem and reading it back
+*/
+static esp_err_t audiosom32_sd_verify (void)
+{
+    uint8_t *wr, *rd;
+    esp_err_t ret = ESP_FAIL;
+    int fd, i;
+
+    wr = heap_caps_malloc (AS32_SD_VERIFY_BYTES, MALLOC_CAP_DMA);
+    rd = heap_caps_malloc (AS32_SD_VERIFY_BYTES, MALLOC_CAP_DMA);
+    if (wr == NULL || rd == NULL)
+        goto verify_done;
+
+    for (i = 0; i < AS32_SD_VERIFY_BYTES; i++)
+        wr[i] = (i * 7) ^ (i >> 8);
+
+    fd = open (AS32_SD_VERIFY_FILE, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0)
+        goto verify_done;
+    i = write (fd, wr, AS32_SD_VERIFY_BYTES);
+    close (fd);
+    if (i != AS32_SD_VERIFY_BYTES)
+        goto verify_done;
+
+    fd = open (AS32_SD_VERIFY_FILE, O_RDONLY);
+    if (fd < 0)
+        goto verify_done;
+    i = read (fd, rd, AS32_SD_VERIFY_BYTES);
+    close (fd);
+    unlink (AS32_SD_VERIFY_FILE);
+
+    if (i == AS32_SD_VERIFY_BYTES && memcmp (wr, rd, AS32_SD_VERIFY_BYTES) == 0)
+        ret = ESP_OK;
+
+    verify_done:
+    free (wr);
+    free (rd);
+    return ret;
+}
+
+/*
+    Mount the SD card in the fastest bus mode that works:
+    4-bit at 40 MHz (high speed), then 4-bit at 20 MHz, then 1-bit at 20 MHz.
+    Each mode must pass a write/read-back check before it is accepted.
+*/
 esp_err_t audiosom32_sd_init (void)
 {
-    esp_err_t ret;
-    sdmmc_host_t host = SDMMC_HOST_DEFAULT();
-    sdmmc_slot_config_t slot_config = SDMMC_SLOT_CONFIG_DEFAULT();
+    esp_err_t ret = ESP_FAIL;
+    int mode;
 
     esp_vfs_fat_sdmmc_mount_config_t mount_config =
     {
@@ -80,12 +147,44 @@ esp_err_t audiosom32_sd_init (void)
         .allocation_unit_size = 4 * 1024
     };
 
-    sdmmc_card_t* card;
-    ret = esp_vfs_fat_sdmmc_mount("/sdcard", &host, &slot_config, &mount_config, &card);
+    for (mode = 0; mode < sizeof (sd_bus_modes) / sizeof (sd_bus_modes[0]); mode++)
+    {
+        sdmmc_host_t host = SDMMC_HOST_DEFAULT();
+        sdmmc_slot_config_t slot_config = SDMMC_SLOT_CONFIG_DEFAULT();
+
+        host.max_freq_khz = sd_bus_modes[mode].freq_khz;
+        slot_config.width = sd_bus_modes[mode].width;
+        if (sd_bus_modes[mode].width == 1)
+            host.flags = SDMMC_HOST_FLAG_1BIT;
+
+        ret = esp_vfs_fat_sdmmc_mount("/sdcard", &host, &slot_config, &mount_config, &sd_card);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGW (TAG, "%s: mount failed (CAUSE: %s)", sd_bus_modes[mode].name, esp_err_to_name(ret));
+            continue;
+        }
+
+        if (audiosom32_sd_verify () == ESP_OK)
+        {
+            sd_mode = mode;
+            break;
+        }
+
+        ESP_LOGW (TAG, "%s: read back check failed", sd_bus_modes[mode].name);
+        esp_vfs_fat_sdmmc_unmount ();
+        sd_card = NULL;
+        ret = ESP_ERR_INVALID_RESPONSE;
+    }
 
     if (ret != ESP_OK)
     {
-        if (ret == ESP_FAIL)
+        if (ret == ESP_ERR_INVALID_RESPONSE)
+        {
+            // The filesystem mounted, the card or the bus is what failed
+            ESP_LOGE (TAG, "SD card mounted but data read back wrong in every bus mode. Check the card and its contacts.");
+            return ret;
+        }
+        else if (ret == ESP_FAIL)
         {
             ESP_LOGE (TAG, "Failed to mount filesystem. Please format SD card.");
             return ret;
@@ -100,8 +199,28 @@ esp_err_t audiosom32_sd_init (void)
     {
         // Everything good, able to read SD card
         // Print some info about the card
-        ESP_LOGI (TAG, "SD card ready!!!");
-        sdmmc_card_print_info(stdout, card);
+        ESP_LOGI (TAG, "SD card ready!!! Bus mode: %s, %d-bit at %d kHz", sd_bus_modes[sd_mode].name,
+            1 << sd_card->log_bus_width, sd_card->max_freq_khz);
+        sdmmc_card_print_info(stdout, sd_card);
         return ESP_OK;
     }
 }
+
+/*
+    Card mounted by audiosom32_sd_init (), NULL if none
+*/
+sdmmc_card_t *audiosom32_sd_card (void)
+{
+    return sd_card;
+}
+
+/*
+    Name of the bus mode chosen by audiosom32_sd_init ()
+*/
+const char *audiosom32_sd_mode (void)
+{
+    if (sd_mode < 0)
+        return "none";
+
+    return sd_bus_modes[sd_mode].name;
+}
@@ -25,6 +25,9 @@ software.
 #ifndef _AUDIOSOM32_CARRIER_H_
 #define _AUDIOSOM32_CARRIER_H_
 
+#include "esp_err.h"
+#include "sdmmc_cmd.h"
+
 #define     AS32_LED_GPIO    25
 
 #define     AS32_BTN_UP      2950
@@ -41,7 +44,13 @@ software.
 #define     AS32_SD_CLK      14
 #define     AS32_SD_CMD      15
 
+// Scratch file and size for the SD bus check at mount
+#define     AS32_SD_VERIFY_FILE     "/sdcard/SDCHECK.TMP"
+#define     AS32_SD_VERIFY_BYTES    4096
+
 void audiosom32_carrier_init (void);
 esp_err_t audiosom32_sd_init (void);
+sdmmc_card_t *audiosom32_sd_card (void);
+const char *audiosom32_sd_mode (void);
 
 #endif
@@ -36,6 +36,7 @@ extern "C" {
 #include "driver/i2s.h"
 #include "soc/soc.h"
 #include "audiosom32_codec.h"
+#include "biquad.h"
 
 // ################ AudioSOM32-specific settings ################
 // Power rails in millivolts
@@ -66,6 +67,8 @@ extern "C" {
 #define AUDIOSOM32_I2S_NUM          (0)
 #define AUDIOSOM32_SAMPLERATE		48000
 #define AUDIOSOM32_BITSPERSAMPLE	16
+#define AUDIOSOM32_DMA_BUF_COUNT    6                       // Number of I2S DMA buffers
+#define AUDIOSOM32_DMA_BUF_LEN      512                     // Frames per I2S DMA buffer
 
 #define WRITE_BIT  				    I2C_MASTER_WRITE        /*!< I2C master write */
 #define READ_BIT   				    I2C_MASTER_READ         /*!< I2C master read */
@@ -77,12 +80,77 @@ extern "C" {
 #define I2C_MASTER_TX_BUF_DISABLE   0                       /*!< I2C master do not need buffer */
 #define I2C_MASTER_RX_BUF_DISABLE   0                       /*!< I2C master do not need buffer */
 
+// SGTL5000 DAP (digital audio processor) parametric EQ
+#define AUDIOSOM32_DAP_MAX_BIQUADS  7                       // Filters in the DAP PEQ cascade
+
+// Where the DAP sits in the codec
+typedef enum
+{
+    AUDIOSOM32_DAP_OFF = 0,                                 // Bypassed and powered down
+    AUDIOSOM32_DAP_RECORD,                                  // ADC -> DAP -> I2S out
+    AUDIOSOM32_DAP_PLAYBACK                                 // I2S in -> DAP -> DAC
+} audiosom32_dap_route_t;
+
+// One biquad in the codec's format: 20-bit two's complement, scaled by 2^18,
+// a1 and a2 stored negated
+typedef struct
+{
+    int32_t b0, b1, b2, a1, a2;
+} audiosom32_biquad_t;
+
+// SGTL5000 DAP automatic volume control (compressor/limiter)
+#define AUDIOSOM32_AVC_SPAN_DB      12                      // Gain change that attack_ms/decay_ms refer to
+
+typedef struct
+{
+    float threshold_db;                                     // Target level, 0 to -96 dBFS
+    uint8_t max_gain_db;                                    // Gain applied to quiet signals: 0, 6 or 12 dB
+    float attack_ms;                                        // Time to cut the gain by AUDIOSOM32_AVC_SPAN_DB
+    float decay_ms;                                         // Time to raise the gain by AUDIOSOM32_AVC_SPAN_DB
+    uint8_t hard_limit;                                     // 1: never exceed threshold, 0: soft knee
+} audiosom32_avc_t;
+
+// Volume controls, 0.5 dB steps
+typedef enum
+{
+    AUDIOSOM32_VOLUME_DAC = 0,                              // Digital DAC volume
+    AUDIOSOM32_VOLUME_HP                                    // Analog headphone amplifier
+} audiosom32_volume_t;
+
+#define AUDIOSOM32_DAC_VOL_MIN_DB   -90.0f
+#define AUDIOSOM32_DAC_VOL_MAX_DB   0.0f
+#define AUDIOSOM32_HP_VOL_MIN_DB    -51.5f
+#define AUDIOSOM32_HP_VOL_MAX_DB    12.0f
+#define AUDIOSOM32_ADC_VOL_MIN_DB   -6.0f
+#define AUDIOSOM32_ADC_VOL_MAX_DB   22.5f
+#define AUDIOSOM32_ADC_VOL_STEP_DB  1.5f
+// Time for the DAC volume ramp to reach mute from 0 dB (180 steps, one per frame at 48kHz)
+#define AUDIOSOM32_DAC_RAMP_US      4000
+
+// Capture input and its analog settings, see audiosom32_set_capture ()
+typedef enum
+{
+    AUDIOSOM32_INPUT_MIC = 0,
+    AUDIOSOM32_INPUT_LINE_IN
+} audiosom32_input_t;
+
+typedef struct
+{
+    audiosom32_input_t source;
+    uint8_t mic_gain;                                       // Mic preamp 0: 0 dB, 1: +20 dB, 2: +30 dB, 3: +40 dB
+    uint8_t mic_bias;                                       // Bias resistor 0: off (hi-Z), 1: 2K, 2: 4K, 3: 8K
+    uint16_t mic_bias_mv;                                   // Bias voltage 1250 to 3000 mV in 250 mV steps
+    float adc_db;                                           // ADC volume, AUDIOSOM32_ADC_VOL_MIN_DB to MAX_DB
+    uint8_t monitor;                                        // 1: HP hears the input, 0: HP muted
+} audiosom32_capture_t;
+
 // General system related APIs
 //esp_err_t audiosom32_poweron_init (void);
 esp_err_t audiosom32_write_reg (i2c_port_t i2c_num, uint16_t reg_addr, uint16_t reg_val);
 esp_err_t audiosom32_read_reg (i2c_port_t i2c_num, uint16_t reg_addr, uint16_t *reg_val);
 void audiosom32_i2c_init();
 void audiosom32_i2s_init();
+esp_err_t audiosom32_i2s_set_dma (int buf_count, int buf_len);
 esp_err_t audiosom32_playback_init (void);
 esp_err_t audiosom32_record_init (void);
 
@@ -91,13 +159,28 @@ esp_err_t audiosom32_set_surround_sound (uint8_t surround);
 esp_err_t audiosom32_set_mic_resistor (uint8_t bias);
 esp_err_t audiosom32_set_mic_voltage (uint16_t voltage);
 esp_err_t audiosom32_set_mic_gain (uint8_t gain);
+esp_err_t audiosom32_set_adc_volume (float db);
+esp_err_t audiosom32_set_capture (const audiosom32_capture_t *capture);
 esp_err_t audiosom32_mute_headphone (void);
 esp_err_t audiosom32_unmute_headphone (void);
 esp_err_t audiosom32_set_ref (uint16_t vag_voltage);
 esp_err_t audiosom32_check_module (void);
 esp_err_t audiosom32_set_digital_volume (int8_t left_vol, int8_t right_vol);
 esp_err_t audiosom32_set_headphone_volume (int8_t left_vol, int8_t right_vol);
+esp_err_t audiosom32_set_volume_db (audiosom32_volume_t out, float left_db, float right_db);
+esp_err_t audiosom32_get_volume_db (audiosom32_volume_t out, float *left_db, float *right_db);
+esp_err_t audiosom32_set_volume_ramp (uint8_t enable, uint8_t exponential);
+esp_err_t audiosom32_set_hp_zcd (uint8_t enable);
 esp_err_t audiosom32_pin_drive_strength (uint8_t i2c_strength, uint8_t i2s_strength);
+esp_err_t audiosom32_power_down_output (void);
+esp_err_t audiosom32_power_up_output (void);
+esp_err_t audiosom32_route_monitor (uint8_t digital);
+esp_err_t audiosom32_biquad_design (biquad_type_t type, float freq, float q, float gain_db, audiosom32_biquad_t *biquad);
+esp_err_t audiosom32_biquad_raw (float b0, float b1, float b2, float a1, float a2, audiosom32_biquad_t *biquad);
+esp_err_t audiosom32_dap_set_eq (const audiosom32_biquad_t *biquads, uint8_t count);
+esp_err_t audiosom32_dap_route (audiosom32_dap_route_t route);
+esp_err_t audiosom32_dap_set_avc (const audiosom32_avc_t *avc);
+esp_err_t audiosom32_dap_set_bass_enhance (uint8_t enable, uint16_t cutoff_hz, float lr_level, float bass_level);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,86 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _BIQUAD_H_
+#define _BIQUAD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Longest cascade supported by biquad_cascade_t
+#define BIQUAD_MAX_SECTIONS         8
+// Fraction bits of the fixed-point coefficients, Q2.30 covers +/-2
+#define BIQUAD_Q                    30
+// Compare all kernels at boot (1) or never (0)
+#define BIQUAD_BENCH_AT_BOOT        0
+// Benchmark cascade, block size and number of blocks
+#define BIQUAD_BENCH_SECTIONS       4
+#define BIQUAD_BENCH_FRAMES         256
+#define BIQUAD_BENCH_BLOCKS         64
+
+typedef enum
+{
+    BIQUAD_LOWPASS = 0,
+    BIQUAD_HIGHPASS,
+    BIQUAD_BANDPASS,
+    BIQUAD_NOTCH,
+    BIQUAD_PEAK,                    // Uses gain_db
+    BIQUAD_LOWSHELF,                // Uses gain_db
+    BIQUAD_HIGHSHELF                // Uses gain_db
+} biquad_type_t;
+
+typedef enum
+{
+    BIQUAD_DF1_INT = 0,             // Direct Form I, Q2.30 with full error feedback, 64-bit accumulator
+    BIQUAD_DF2T_INT,                // Transposed Direct Form II, Q2.30 with 64-bit state
+    BIQUAD_DF1_FLOAT,               // Direct Form I on the FPU
+    BIQUAD_DF2T_FLOAT,              // Transposed Direct Form II on the FPU
+    BIQUAD_KERNELS
+} biquad_kernel_t;
+
+// Cascade of biquads applied to both channels of interleaved 16-bit stereo
+typedef struct
+{
+    biquad_kernel_t kernel;
+    int sections;
+    union
+    {
+        int32_t q[BIQUAD_MAX_SECTIONS][5];      // b0, b1, b2, a1, a2 in Q2.30
+        float f[BIQUAD_MAX_SECTIONS][5];        // b0, b1, b2, a1, a2
+    } coef;
+    union
+    {
+        int64_t q[2][BIQUAD_MAX_SECTIONS][6];   // DF1: x1, x2, y1, y2, e1, e2, DF2T: s1, s2
+        float f[2][BIQUAD_MAX_SECTIONS][6];
+    } state;
+} biquad_cascade_t;
+
+esp_err_t biquad_calc (biquad_type_t type, float freq, float q, float gain_db, uint32_t sample_rate, float coef[5]);
+esp_err_t biquad_init (biquad_cascade_t *bq, biquad_kernel_t kernel, const float (*coefs)[5], int sections);
+void biquad_reset (biquad_cascade_t *bq);
+void biquad_process (int16_t *samples, size_t frames, void *arg);
+esp_err_t biquad_bench_run (void);
+
+#endif
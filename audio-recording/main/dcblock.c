@@ -0,0 +1,181 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "xtensa/hal.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "dcblock.h"
+#include "audiosom32_driver.h"
+#include "audio_pm.h"
+
+static const char *TAG = "dcblock.c";
+
+/*
+    Prepare a DC blocker for interleaved stereo at sample_rate
+*/
+esp_err_t dcblock_init (dcblock_t *dc, dcblock_type_t type, float corner_hz, uint32_t sample_rate)
+{
+    float coef[1][5];
+
+    if (corner_hz <= 0 || corner_hz >= sample_rate / 4)
+        return ESP_ERR_INVALID_ARG;
+
+    memset (dc, 0, sizeof (*dc));
+    dc->type = type;
+
+    if (type == DCBLOCK_HIGHPASS)
+    {
+        if (biquad_calc (BIQUAD_HIGHPASS, corner_hz, 0.7071f, 0, sample_rate, coef[0]) != ESP_OK)
+            return ESP_FAIL;
+        return biquad_init (&dc->hp, BIQUAD_DF1_INT, coef, 1);
+    }
+
+    // Pole at a = 1 - 2*pi*fc/fs puts the -3 dB point at fc
+    dc->k = (int32_t) lroundf (2 * M_PI * corner_hz / sample_rate * (1 << 30));
+    return ESP_OK;
+}
+
+/*
+    In place on a block of interleaved stereo, both channels in the same
+    pass with their state in registers. Integer only. Same signature as a
+    monitor stage, arg is the dcblock_t.
+*/
+void IRAM_ATTR dcblock_process (int16_t *samples, size_t frames, void *arg)
+{
+    dcblock_t *dc = arg;
+    int32_t l, r, xl1, xr1, yl, yr, k, out;
+    size_t i;
+
+    if (dc->type == DCBLOCK_HIGHPASS)
+    {
+        biquad_process (samples, frames, &dc->hp);
+        return;
+    }
+
+    k = dc->k;
+    xl1 = dc->x1[0];
+    xr1 = dc->x1[1];
+    yl = dc->y[0];
+    yr = dc->y[1];
+
+    for (i = 0; i < frames; i++)
+    {
+        l = samples[2*i];
+        r = samples[2*i + 1];
+
+        // y += (x - x[-1]) - (1 - a)*y, the fraction stays in y
+        yl += ((l - xl1) << DCBLOCK_STATE_Q) - (int32_t) (((int64_t) yl * k) >> 30);
+        yr += ((r - xr1) << DCBLOCK_STATE_Q) - (int32_t) (((int64_t) yr * k) >> 30);
+        xl1 = l;
+        xr1 = r;
+
+        out = (yl + (1 << (DCBLOCK_STATE_Q - 1))) >> DCBLOCK_STATE_Q;
+        samples[2*i] = out > 32767 ? 32767 : (out < -32768 ? -32768 : out);
+        out = (yr + (1 << (DCBLOCK_STATE_Q - 1))) >> DCBLOCK_STATE_Q;
+        samples[2*i + 1] = out > 32767 ? 32767 : (out < -32768 ? -32768 : out);
+    }
+
+    dc->x1[0] = xl1;
+    dc->x1[1] = xr1;
+    dc->y[0] = yl;
+    dc->y[1] = yr;
+}
+
+/*
+    Cycles per sample of both filters on recorder sized blocks, their share
+    of the time one block takes to capture, and the DC left over from a
+    -12 dBFS noise input with a +1000 LSB offset
+*/
+esp_err_t dcblock_bench_run (void)
+{
+    static const char *names[] = { "one-pole", "high-pass" };
+    dcblock_t *dc;
+    int16_t *input, *work;
+    uint32_t start, cycles, samples, budget;
+    int64_t sum;
+    int t, b, i;
+
+    dc = heap_caps_malloc (sizeof (dcblock_t), MALLOC_CAP_8BIT);
+    input = heap_caps_malloc (DCBLOCK_BENCH_FRAMES * 4 * DCBLOCK_BENCH_BLOCKS, MALLOC_CAP_8BIT);
+    work = heap_caps_malloc (DCBLOCK_BENCH_FRAMES * 4, MALLOC_CAP_8BIT);
+    if (dc == NULL || input == NULL || work == NULL)
+    {
+        ESP_LOGE (TAG, "Not enough memory for the DC blocker benchmark");
+        free (dc);
+        free (input);
+        free (work);
+        return ESP_ERR_NO_MEM;
+    }
+
+    srand (1);
+    for (i = 0; i < DCBLOCK_BENCH_FRAMES * 2 * DCBLOCK_BENCH_BLOCKS; i++)
+        input[i] = (rand () % 16384) - 8192 + 1000;
+
+    // CPU cycles available while one block is captured
+    budget = (uint64_t) DCBLOCK_BENCH_FRAMES * CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ * 1000000 / AUDIOSOM32_SAMPLERATE;
+
+    audio_pm_work_begin ();
+    for (t = DCBLOCK_ONE_POLE; t <= DCBLOCK_HIGHPASS; t++)
+    {
+        dcblock_init (dc, t, DCBLOCK_CORNER_HZ, AUDIOSOM32_SAMPLERATE);
+        cycles = 0;
+        sum = 0;
+
+        for (b = 0; b < DCBLOCK_BENCH_BLOCKS; b++)
+        {
+            memcpy (work, input + b * DCBLOCK_BENCH_FRAMES * 2, DCBLOCK_BENCH_FRAMES * 4);
+            start = xthal_get_ccount ();
+            dcblock_process (work, DCBLOCK_BENCH_FRAMES, dc);
+            cycles += xthal_get_ccount () - start;
+
+            // Mean of the second half, after the filter has settled
+            if (b >= DCBLOCK_BENCH_BLOCKS / 2)
+                for (i = 0; i < DCBLOCK_BENCH_FRAMES * 2; i++)
+                    sum += work[i];
+        }
+
+        samples = DCBLOCK_BENCH_FRAMES * 2 * DCBLOCK_BENCH_BLOCKS;
+        ESP_LOGI (TAG, "%-9s %d Hz: %d.%02d cycles/sample, %d.%02d%% of the capture budget, DC left %d LSB",
+            names[t], DCBLOCK_CORNER_HZ, cycles / samples, (cycles % samples) * 100 / samples,
+            cycles / DCBLOCK_BENCH_BLOCKS * 100 / budget, cycles / DCBLOCK_BENCH_BLOCKS * 10000 / budget % 100,
+            (int) (sum / (samples / 2)));
+    }
+    audio_pm_work_end ();
+
+    free (dc);
+    free (input);
+    free (work);
+
+    return ESP_OK;
+}
@@ -0,0 +1,62 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _DCBLOCK_H_
+#define _DCBLOCK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "biquad.h"
+
+typedef enum
+{
+    DCBLOCK_ONE_POLE = 0,           // y = x - x[-1] + a*y[-1], 6 dB/octave below the corner
+    DCBLOCK_HIGHPASS                // Second order Butterworth high-pass, 12 dB/octave
+} dcblock_type_t;
+
+// Filter and corner used by the recorder
+#define DCBLOCK_TYPE                DCBLOCK_ONE_POLE
+#define DCBLOCK_CORNER_HZ           10
+// Fraction bits of the one-pole state, so rounding adds no DC of its own
+#define DCBLOCK_STATE_Q             14
+// Compare both filters at boot (1) or never (0)
+#define DCBLOCK_BENCH_AT_BOOT       0
+#define DCBLOCK_BENCH_FRAMES        512
+#define DCBLOCK_BENCH_BLOCKS        64
+
+typedef struct
+{
+    dcblock_type_t type;
+    int32_t k;                      // One-pole: 1 - a in Q.30
+    int32_t x1[2];                  // One-pole: last input per channel
+    int32_t y[2];                   // One-pole: last output per channel, Q.DCBLOCK_STATE_Q
+    biquad_cascade_t hp;            // High-pass: one DF1 integer section
+} dcblock_t;
+
+esp_err_t dcblock_init (dcblock_t *dc, dcblock_type_t type, float corner_hz, uint32_t sample_rate);
+void dcblock_process (int16_t *samples, size_t frames, void *arg);
+esp_err_t dcblock_bench_run (void);
+
+#endif
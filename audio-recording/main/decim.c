@@ -0,0 +1,206 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "xtensa/hal.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "decim.h"
+#include "audiosom32_driver.h"
+#include "audio_pm.h"
+
+static const char *TAG = "decim.c";
+
+/*
+    Zeroth order modified Bessel function, for the Kaiser window
+*/
+static float decim_bessel_i0 (float x)
+{
+    float sum = 1, term = 1;
+    int k;
+
+    for (k = 1; k < 32; k++)
+    {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/*
+    Kaiser windowed sinc low-pass at DECIM_CUTOFF_HZ for input at in_rate,
+    normalized to unity gain at DC
+*/
+esp_err_t decim_init (decim_t *dc, uint32_t in_rate)
+{
+    float h[DECIM_TAPS], sum = 0, fc, t, w;
+    int k;
+
+    if (in_rate == 0 || DECIM_CUTOFF_HZ * 2 * DECIM_FACTOR >= in_rate)
+        return ESP_ERR_INVALID_ARG;
+
+    fc = (float) DECIM_CUTOFF_HZ / in_rate;
+    for (k = 0; k < DECIM_TAPS; k++)
+    {
+        t = k - (DECIM_TAPS - 1) / 2.0f;
+        h[k] = (t == 0) ? 2 * fc : sinf (2 * M_PI * fc * t) / (M_PI * t);
+        w = 2.0f * k / (DECIM_TAPS - 1) - 1;
+        h[k] *= decim_bessel_i0 (DECIM_KAISER_BETA * sqrtf (1 - w * w)) / decim_bessel_i0 (DECIM_KAISER_BETA);
+        sum += h[k];
+    }
+
+    // Reversed, so the inner loop walks coefficients and history the same way
+    for (k = 0; k < DECIM_TAPS; k++)
+        dc->coef[DECIM_TAPS - 1 - k] = (int16_t) lroundf (h[k] / sum * 32767);
+
+    decim_reset (dc);
+    return ESP_OK;
+}
+
+void decim_reset (decim_t *dc)
+{
+    memset (dc->hist, 0, sizeof (dc->hist));
+    dc->phase = 0;
+}
+
+/*
+    Low-pass and keep every DECIM_FACTOR-th sample of a block of mono or
+    interleaved stereo (mixed to mid). Outputs are only computed at the low
+    rate, DECIM_TAPS multiplies each, the cost of the polyphase form.
+    The phase carries across blocks, so any block length works.
+    Returns the number of samples written to out (at most DECIM_MAX_OUT).
+*/
+size_t IRAM_ATTR decim_process (decim_t *dc, const int16_t *in, size_t frames, int channels, int16_t *out)
+{
+    int16_t *hist = dc->hist;
+    const int16_t *x, *h;
+    int32_t acc;
+    size_t i, n = 0;
+    int k;
+
+    if (frames > DECIM_MAX_FRAMES)
+        frames = DECIM_MAX_FRAMES;
+
+    // New samples go after the last DECIM_TAPS - 1
+    if (channels == 2)
+        for (i = 0; i < frames; i++)
+            hist[DECIM_TAPS - 1 + i] = (in[2*i] + in[2*i + 1]) >> 1;
+    else
+        memcpy (&hist[DECIM_TAPS - 1], in, frames * sizeof (int16_t));
+
+    for (i = dc->phase; i < frames; i += DECIM_FACTOR)
+    {
+        x = &hist[i];
+        h = dc->coef;
+        acc = 1 << 14;
+        for (k = 0; k < DECIM_TAPS; k += 4)
+        {
+            acc += h[k] * x[k];
+            acc += h[k + 1] * x[k + 1];
+            acc += h[k + 2] * x[k + 2];
+            acc += h[k + 3] * x[k + 3];
+        }
+        acc >>= 15;
+        out[n++] = acc > 32767 ? 32767 : (acc < -32768 ? -32768 : acc);
+    }
+    dc->phase = i - frames;
+
+    memmove (hist, &hist[frames], (DECIM_TAPS - 1) * sizeof (int16_t));
+    return n;
+}
+
+/*
+    Cycles per input frame and share of one core at the capture rate, plus
+    the gain in the passband and in the stopband
+*/
+esp_err_t decim_bench_run (void)
+{
+    static const float tones[] = { 1000, 6000, 9000, 12000 };
+    decim_t *dc;
+    int16_t *input, *out;
+    uint32_t start, cycles, frames;
+    float peak, gain;
+    size_t n;
+    int t, b, i;
+
+    dc = heap_caps_malloc (sizeof (decim_t), MALLOC_CAP_8BIT);
+    input = heap_caps_malloc (DECIM_MAX_FRAMES * 4, MALLOC_CAP_8BIT);
+    out = heap_caps_malloc (DECIM_MAX_OUT * 2, MALLOC_CAP_8BIT);
+    if (dc == NULL || input == NULL || out == NULL || decim_init (dc, AUDIOSOM32_SAMPLERATE) != ESP_OK)
+    {
+        ESP_LOGE (TAG, "Not enough memory for the decimator benchmark");
+        free (dc);
+        free (input);
+        free (out);
+        return ESP_ERR_NO_MEM;
+    }
+
+    audio_pm_work_begin ();
+    for (t = 0; t < sizeof (tones) / sizeof (tones[0]); t++)
+    {
+        decim_reset (dc);
+        cycles = 0;
+        frames = 0;
+        peak = 0;
+
+        // -6 dBFS tone on both channels
+        for (b = 0; b < DECIM_BENCH_BLOCKS; b++)
+        {
+            for (i = 0; i < DECIM_MAX_FRAMES; i++)
+                input[2*i] = input[2*i + 1] = (int16_t) (16384 * sinf (2 * M_PI * tones[t] * (b * DECIM_MAX_FRAMES + i) / AUDIOSOM32_SAMPLERATE));
+
+            start = xthal_get_ccount ();
+            n = decim_process (dc, input, DECIM_MAX_FRAMES, 2, out);
+            cycles += xthal_get_ccount () - start;
+            frames += DECIM_MAX_FRAMES;
+
+            // Peak after the filter has filled up
+            if (b >= 2)
+                for (i = 0; i < n; i++)
+                    peak = fmaxf (peak, abs (out[i]));
+        }
+
+        gain = peak > 0 ? 20 * log10f (peak / 16384) : -96;
+        ESP_LOGI (TAG, "%5d Hz: %.1f dB, %d.%02d cycles/input frame, %d.%02d%% of one core",
+            (int) tones[t], gain, cycles / frames, (cycles % frames) * 100 / frames,
+            (int) ((uint64_t) cycles * AUDIOSOM32_SAMPLERATE / frames / (CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ * 10000)),
+            (int) ((uint64_t) cycles * AUDIOSOM32_SAMPLERATE / frames / (CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ * 100) % 100));
+    }
+    audio_pm_work_end ();
+
+    free (dc);
+    free (input);
+    free (out);
+
+    return ESP_OK;
+}
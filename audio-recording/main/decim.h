@@ -0,0 +1,59 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _DECIM_H_
+#define _DECIM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// 48 kHz -> 16 kHz
+#define DECIM_FACTOR                3
+// Low-pass FIR length, a multiple of DECIM_FACTOR (taps per polyphase branch = DECIM_TAPS/DECIM_FACTOR)
+#define DECIM_TAPS                  120
+// -6 dB point of the low-pass and its Kaiser window beta (5.65: about 60 dB stopband)
+#define DECIM_CUTOFF_HZ             7250
+#define DECIM_KAISER_BETA           5.65f
+// Largest block passed to decim_process (), in frames, longer ones are cut
+#define DECIM_MAX_FRAMES            512
+// Output samples per call at most
+#define DECIM_MAX_OUT               (DECIM_MAX_FRAMES / DECIM_FACTOR + 1)
+// Measure the decimator at boot (1) or never (0)
+#define DECIM_BENCH_AT_BOOT         0
+#define DECIM_BENCH_BLOCKS          64
+
+typedef struct
+{
+    int16_t coef[DECIM_TAPS];                       // Q15, time reversed
+    int16_t hist[DECIM_TAPS - 1 + DECIM_MAX_FRAMES];  // Mono input, oldest first
+    int phase;                                      // Input samples to skip before the next output
+} decim_t;
+
+esp_err_t decim_init (decim_t *dc, uint32_t in_rate);
+void decim_reset (decim_t *dc);
+size_t decim_process (decim_t *dc, const int16_t *in, size_t frames, int channels, int16_t *out);
+esp_err_t decim_bench_run (void);
+
+#endif
@@ -0,0 +1,162 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "xtensa/hal.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "dither.h"
+#include "audio_pm.h"
+
+static const char *TAG = "dither.c";
+
+void dither_init (dither_t *dt, dither_mode_t mode)
+{
+    memset (dt, 0, sizeof (*dt));
+    dt->mode = mode;
+    dt->seed = 0x2545F491;
+}
+
+/*
+    Reduce interleaved stereo in 32-bit I2S slot format (24-bit samples in
+    the top bits, full scale 2^31) to 16-bit. out may point to the same
+    buffer as in, so a block read from I2S in 32-bit slots can be reduced
+    in place before the writer, or samples prepared at higher resolution
+    can be reduced just ahead of i2s_write ().
+
+    Works in 16.8 fixed point: 8 fraction bits below the output LSB are
+    all a 24-bit sample has.
+*/
+void IRAM_ATTR dither_process (dither_t *dt, const int32_t *in, int16_t *out, size_t frames)
+{
+    uint32_t seed = dt->seed, r;
+    int32_t v, y, e, d;
+    int32_t el1 = dt->err[0][0], el2 = dt->err[0][1];
+    int32_t er1 = dt->err[1][0], er2 = dt->err[1][1];
+    dither_mode_t mode = dt->mode;
+    size_t i;
+
+    for (i = 0; i < frames; i++)
+    {
+        // One xorshift32 step gives both uniform pairs for the frame
+        if (mode != DITHER_ROUND)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+        }
+        r = seed;
+
+        // Left
+        v = in[2*i] >> 8;
+        if (mode == DITHER_TPDF_SHAPED1)
+            v -= el1;
+        else if (mode == DITHER_TPDF_SHAPED2)
+            v -= 2*el1 - el2;
+        d = (mode == DITHER_ROUND) ? 0 : (int32_t) (r & 0xFF) + (int32_t) ((r >> 8) & 0xFF) - 255;
+        y = (v + d + 128) >> 8;
+        y = y > 32767 ? 32767 : (y < -32768 ? -32768 : y);
+        e = (y << 8) - v;
+        el2 = el1;
+        el1 = e > DITHER_ERROR_LIMIT ? DITHER_ERROR_LIMIT : (e < -DITHER_ERROR_LIMIT ? -DITHER_ERROR_LIMIT : e);
+        out[2*i] = y;
+
+        // Right
+        v = in[2*i + 1] >> 8;
+        if (mode == DITHER_TPDF_SHAPED1)
+            v -= er1;
+        else if (mode == DITHER_TPDF_SHAPED2)
+            v -= 2*er1 - er2;
+        d = (mode == DITHER_ROUND) ? 0 : (int32_t) ((r >> 16) & 0xFF) + (int32_t) (r >> 24) - 255;
+        y = (v + d + 128) >> 8;
+        y = y > 32767 ? 32767 : (y < -32768 ? -32768 : y);
+        e = (y << 8) - v;
+        er2 = er1;
+        er1 = e > DITHER_ERROR_LIMIT ? DITHER_ERROR_LIMIT : (e < -DITHER_ERROR_LIMIT ? -DITHER_ERROR_LIMIT : e);
+        out[2*i + 1] = y;
+    }
+
+    dt->seed = seed;
+    dt->err[0][0] = el1;
+    dt->err[0][1] = el2;
+    dt->err[1][0] = er1;
+    dt->err[1][1] = er2;
+}
+
+/*
+    Cycles per sample of each mode, reducing in place like a capture block
+*/
+esp_err_t dither_bench_run (void)
+{
+    static const char *names[] = { "round", "TPDF", "TPDF+NS1", "TPDF+NS2" };
+    dither_t dt;
+    int32_t *input, *work;
+    uint32_t start, cycles, samples;
+    int m, b, i;
+
+    input = heap_caps_malloc (DITHER_BENCH_FRAMES * 8, MALLOC_CAP_8BIT);
+    work = heap_caps_malloc (DITHER_BENCH_FRAMES * 8, MALLOC_CAP_8BIT);
+    if (input == NULL || work == NULL)
+    {
+        ESP_LOGE (TAG, "Not enough memory for the dither benchmark");
+        free (input);
+        free (work);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // -12 dBFS noise in 24-bit resolution
+    srand (1);
+    for (i = 0; i < DITHER_BENCH_FRAMES * 2; i++)
+        input[i] = ((rand () % (1 << 22)) - (1 << 21)) << 8;
+
+    audio_pm_work_begin ();
+    for (m = DITHER_ROUND; m < DITHER_MODES; m++)
+    {
+        dither_init (&dt, m);
+        cycles = 0;
+        for (b = 0; b < DITHER_BENCH_BLOCKS; b++)
+        {
+            memcpy (work, input, DITHER_BENCH_FRAMES * 8);
+            start = xthal_get_ccount ();
+            dither_process (&dt, work, (int16_t *) work, DITHER_BENCH_FRAMES);
+            cycles += xthal_get_ccount () - start;
+        }
+        samples = DITHER_BENCH_FRAMES * 2 * DITHER_BENCH_BLOCKS;
+        ESP_LOGI (TAG, "%-9s %d.%02d cycles/sample", names[m], cycles / samples, (cycles % samples) * 100 / samples);
+    }
+    audio_pm_work_end ();
+
+    free (input);
+    free (work);
+
+    return ESP_OK;
+}
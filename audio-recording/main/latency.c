@@ -0,0 +1,233 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "latency.h"
+#include "audiosom32_driver.h"
+#include "audio_pm.h"
+
+static const char *TAG = "latency.c";
+
+// I2S DMA buffering to measure, as count x frames
+static const struct
+{
+    int buf_count;
+    int buf_len;
+} latency_profiles[] =
+{
+    { 2, 32 },
+    { 3, 32 },
+    { 2, 64 },
+    { 4, 64 },
+    { 4, 128 },
+    { AUDIOSOM32_DMA_BUF_COUNT, AUDIOSOM32_DMA_BUF_LEN },
+};
+
+#define LATENCY_PROFILES    (sizeof (latency_profiles) / sizeof (latency_profiles[0]))
+
+// Result of the last latency_run () per profile in samples, 0 if not measured
+static int32_t latency_measured[LATENCY_PROFILES];
+
+/*
+    Hann windowed linear chirp, the window keeps correlation side lobes low
+*/
+static void latency_make_chirp (int16_t *chirp, size_t frames)
+{
+    float phase = 0, f, w;
+    size_t i;
+
+    for (i = 0; i < frames; i++)
+    {
+        f = LATENCY_CHIRP_F0 + (float) (LATENCY_CHIRP_F1 - LATENCY_CHIRP_F0) * i / frames;
+        w = 0.5f - 0.5f * cosf (2 * (float) M_PI * i / (frames - 1));
+        chirp[i] = (int16_t) (LATENCY_CHIRP_LEVEL * w * sinf (phase));
+        phase += 2 * (float) M_PI * f / AUDIOSOM32_SAMPLERATE;
+    }
+}
+
+/*
+    Offset of ref within sig in samples, from the peak of their cross-correlation.
+    The codec may invert the signal, so the largest magnitude wins.
+    Returns -1 if the peak does not stand out from the rest of the correlation
+    by LATENCY_MIN_PEAK_RATIO (no loopback cable, too much noise).
+    Plain C without IDF calls, so it can be checked against synthetic delays.
+*/
+int32_t latency_correlate (const int16_t *ref, size_t ref_len, const int16_t *sig, size_t sig_len)
+{
+    int64_t corr, peak = 0;
+    double sum_sq = 0;
+    size_t lag, i, lags;
+    int32_t peak_lag = -1;
+
+    if (sig_len < ref_len)
+        return -1;
+
+    lags = sig_len - ref_len + 1;
+    for (lag = 0; lag < lags; lag++)
+    {
+        corr = 0;
+        for (i = 0; i < ref_len; i++)
+            corr += (int32_t) ref[i] * sig[lag + i];
+        if (corr < 0)
+            corr = -corr;
+
+        sum_sq += (double) corr * corr;
+        if (corr > peak)
+        {
+            peak = corr;
+            peak_lag = lag;
+        }
+    }
+
+    if (peak == 0 || (double) peak * peak < sum_sq / lags * LATENCY_MIN_PEAK_RATIO * LATENCY_MIN_PEAK_RATIO)
+        return -1;
+
+    return peak_lag;
+}
+
+/*
+    Play the chirp through the full-duplex loop with one DMA profile and
+    capture the left channel of the input. Blocks are read and written in
+    lockstep, exactly like the monitor task, so the lag found is the latency
+    monitoring would have with this profile.
+*/
+static int32_t latency_measure (int buf_count, int buf_len, const int16_t *chirp,
+                                int16_t *block, int16_t *capture)
+{
+    size_t bytes, i;
+    int settle_blocks = LATENCY_SETTLE_MS * AUDIOSOM32_SAMPLERATE / 1000 / buf_len;
+    int frame = 0, captured = 0;
+
+    if (audiosom32_i2s_set_dma (buf_count, buf_len) != ESP_OK)
+        return -1;
+    i2s_zero_dma_buffer (AUDIOSOM32_I2S_NUM);
+
+    // Silence until both DMA rings run at their steady depth
+    while (settle_blocks-- > 0)
+    {
+        i2s_read (AUDIOSOM32_I2S_NUM, block, buf_len * 4, &bytes, portMAX_DELAY);
+        memset (block, 0, buf_len * 4);
+        i2s_write (AUDIOSOM32_I2S_NUM, block, buf_len * 4, &bytes, portMAX_DELAY);
+    }
+
+    // Chirp on both channels starting with the first block, input from the same block on
+    while (captured < LATENCY_WINDOW_FRAMES)
+    {
+        i2s_read (AUDIOSOM32_I2S_NUM, block, buf_len * 4, &bytes, portMAX_DELAY);
+        for (i = 0; i < bytes / 4 && captured < LATENCY_WINDOW_FRAMES; i++)
+            capture[captured++] = block[2 * i];
+
+        for (i = 0; i < buf_len; i++, frame++)
+            block[2 * i] = block[2 * i + 1] = (frame < LATENCY_CHIRP_FRAMES) ? chirp[frame] : 0;
+        i2s_write (AUDIOSOM32_I2S_NUM, block, buf_len * 4, &bytes, portMAX_DELAY);
+    }
+
+    return latency_correlate (chirp, LATENCY_CHIRP_FRAMES, capture, LATENCY_WINDOW_FRAMES);
+}
+
+/*
+    Measure line in -> ESP32 -> HP latency for every profile in latency_profiles.
+    The codec must route I2S in to the DAC (audiosom32_route_monitor (1)).
+    I2S is left with the default DMA buffering.
+*/
+esp_err_t latency_run (void)
+{
+    int16_t *chirp, *block, *capture;
+    int32_t lag;
+    int i, measured = 0;
+
+    chirp = heap_caps_malloc (LATENCY_CHIRP_FRAMES * sizeof (int16_t), MALLOC_CAP_8BIT);
+    block = heap_caps_malloc (AUDIOSOM32_DMA_BUF_LEN * 4, MALLOC_CAP_8BIT);
+    capture = heap_caps_malloc (LATENCY_WINDOW_FRAMES * sizeof (int16_t), MALLOC_CAP_8BIT);
+    if (chirp == NULL || block == NULL || capture == NULL)
+    {
+        ESP_LOGE (TAG, "Not enough memory for the latency test");
+        free (chirp);
+        free (block);
+        free (capture);
+        return ESP_ERR_NO_MEM;
+    }
+
+    latency_make_chirp (chirp, LATENCY_CHIRP_FRAMES);
+    ESP_LOGW (TAG, "Measuring round trip latency, connect HP out to line in");
+
+    audio_pm_work_begin ();
+    for (i = 0; i < LATENCY_PROFILES; i++)
+    {
+        if (latency_profiles[i].buf_len > AUDIOSOM32_DMA_BUF_LEN)
+            continue;
+
+        lag = latency_measure (latency_profiles[i].buf_count, latency_profiles[i].buf_len, chirp, block, capture);
+        if (lag < 0)
+        {
+            ESP_LOGW (TAG, "%d x %d frames: no loopback signal found", latency_profiles[i].buf_count,
+                latency_profiles[i].buf_len);
+            continue;
+        }
+
+        measured++;
+        latency_measured[i] = lag;
+        ESP_LOGI (TAG, "%d x %d frames: %d samples, %d us (buffering %d samples)",
+            latency_profiles[i].buf_count, latency_profiles[i].buf_len, lag,
+            (uint32_t) ((int64_t) lag * 1000000 / AUDIOSOM32_SAMPLERATE),
+            (1 + latency_profiles[i].buf_count) * latency_profiles[i].buf_len);
+    }
+    audio_pm_work_end ();
+
+    audiosom32_i2s_set_dma (AUDIOSOM32_DMA_BUF_COUNT, AUDIOSOM32_DMA_BUF_LEN);
+    free (chirp);
+    free (block);
+    free (capture);
+
+    return (measured > 0) ? ESP_OK : ESP_FAIL;
+}
+
+/*
+    Round trip latency in samples measured for a DMA profile by latency_run (),
+    -1 if it was not measured
+*/
+int32_t latency_lookup (int buf_count, int buf_len)
+{
+    int i;
+
+    for (i = 0; i < LATENCY_PROFILES; i++)
+    {
+        if (latency_profiles[i].buf_count == buf_count && latency_profiles[i].buf_len == buf_len &&
+            latency_measured[i] > 0)
+            return latency_measured[i];
+    }
+
+    return -1;
+}
@@ -0,0 +1,51 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Measure the round trip latency at boot (1) or never (0).
+// Needs a loopback cable from HP out to line in, the chirp is audible!
+#define LATENCY_TEST_AT_BOOT        0
+// Test signal: linear chirp from LATENCY_CHIRP_F0 to LATENCY_CHIRP_F1 Hz
+#define LATENCY_CHIRP_FRAMES        256
+#define LATENCY_CHIRP_F0            200
+#define LATENCY_CHIRP_F1            8000
+#define LATENCY_CHIRP_LEVEL         8192        // Peak amplitude, -12 dBFS
+// Input captured after the chirp is sent, must cover the slowest DMA profile
+#define LATENCY_WINDOW_FRAMES       8192
+// Silence played before the chirp so the TX DMA queue is at its steady depth
+#define LATENCY_SETTLE_MS           200
+// Correlation peak must be this many times the correlation RMS to count
+#define LATENCY_MIN_PEAK_RATIO      8
+
+esp_err_t latency_run (void);
+int32_t latency_lookup (int buf_count, int buf_len);
+int32_t latency_correlate (const int16_t *ref, size_t ref_len, const int16_t *sig, size_t sig_len);
+
+#endif
@@ -36,12 +36,31 @@ software.
 #include "audiosom32_driver.h"
 #include "audiosom32_carrier.h"
 #include "recorder.h"
+#include "profiler.h"
+#include "audio_pm.h"
+#include "audio_mem.h"
+#include "biquad.h"
+#include "dither.h"
+#include "dcblock.h"
+#include "decim.h"
+#include "sd_bench.h"
+#include "writer.h"
+#include "wav.h"
 
 static const char *TAG = "main.c";
 
 void app_main()
 {
+    // All audio buffers come from one arena, allocate it before anything else
+    if (audio_mem_init () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to allocate audio memory arena!");
+
+    // Dynamic frequency scaling, CPU runs at max only while audio work is pending
+    if (audio_pm_init (AUDIO_PM_DEFAULT_MODE) != ESP_OK)
+        ESP_LOGE (TAG, "Failed to configure power management!");
+
     // Initialize the I2S clocks
+    audio_pm_stream_start ();
     audiosom32_i2s_init ();
     // Wait for MCLK to stabilize
     ets_delay_us (1000);
@@ -57,6 +76,31 @@ void app_main()
         vTaskDelay (5000/portTICK_RATE_MS);
     }
 
+    // Recordings cut short by a power loss still have the sizes of their last checkpoint
+    if (wav_repair_all ("/sdcard") > 0)
+        ESP_LOGW (TAG, "Repaired WAV files left open at power loss");
+
+    // Find out now if the card is fast enough, not when the recording glitches
+    if (SD_BENCH_AT_MOUNT && sd_bench_run () != ESP_OK)
+        ESP_LOGE (TAG, "SD card benchmark failed!");
+
+    // Cycles per sample of the DSP kernels, to choose what runs on the CPU
+    if (BIQUAD_BENCH_AT_BOOT && biquad_bench_run () != ESP_OK)
+        ESP_LOGE (TAG, "Biquad benchmark failed!");
+    if (DITHER_BENCH_AT_BOOT && dither_bench_run () != ESP_OK)
+        ESP_LOGE (TAG, "Dither benchmark failed!");
+
+    if (DCBLOCK_BENCH_AT_BOOT && dcblock_bench_run () != ESP_OK)
+        ESP_LOGE (TAG, "DC blocker benchmark failed!");
+    if (DECIM_BENCH_AT_BOOT && decim_bench_run () != ESP_OK)
+        ESP_LOGE (TAG, "Decimator benchmark failed!");
+    if (WRITER_BENCH_AT_BOOT && writer_bench_run (AUDIOSOM32_SAMPLERATE * 4) != ESP_OK)
+        ESP_LOGE (TAG, "Writer benchmark failed!");
+
     // Create a task to record audio
     xTaskCreate(&audio_rec_task, "audio_rec_task", 4096, NULL, 8, NULL);
+
+    // Periodic CPU load, stack and heap report
+    if (profiler_start () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to start profiler!");
 }
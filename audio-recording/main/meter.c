@@ -0,0 +1,260 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/ledc.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "xtensa/hal.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "meter.h"
+#include "audiosom32_carrier.h"
+
+static const char *TAG = "meter.c";
+
+#define METER_SILENCE_DB            -96.0f
+
+// Running totals of the current window, filled by meter_process ()
+typedef struct
+{
+    uint32_t peak[METER_CHANNELS];
+    uint64_t sum_sq[METER_CHANNELS];
+    uint32_t clips[METER_CHANNELS];
+    uint32_t frames;
+} meter_acc_t;
+
+static portMUX_TYPE meter_lock = portMUX_INITIALIZER_UNLOCKED;
+static meter_acc_t acc;
+static meter_levels_t levels;
+static bool meter_running = false;
+
+// Cost of the kernel since the last meter_report (), 64 bits as the monitor
+// stage runs all the time (32 bits of cycles wrap within an hour)
+static uint64_t kernel_cycles = 0;
+static uint64_t kernel_samples = 0;
+
+/*
+    Single pass over a block of interleaved stereo samples: peak, sum of
+    squares and clip count per channel. Runs in the audio task, so it only
+    adds to the window totals, dB conversion happens in the meter task.
+    Same signature as a monitor stage.
+*/
+void IRAM_ATTR meter_process (int16_t *samples, size_t frames, void *arg)
+{
+    uint32_t peak_l = 0, peak_r = 0, clip_l = 0, clip_r = 0;
+    uint64_t sq_l = 0, sq_r = 0;
+    uint32_t start = xthal_get_ccount ();
+    int32_t l, r;
+    size_t i;
+
+    for (i = 0; i < frames; i++)
+    {
+        l = samples[2*i];
+        r = samples[2*i + 1];
+        sq_l += (uint32_t) (l * l);
+        sq_r += (uint32_t) (r * r);
+        l = l < 0 ? -l : l;
+        r = r < 0 ? -r : r;
+        peak_l = (uint32_t) l > peak_l ? (uint32_t) l : peak_l;
+        peak_r = (uint32_t) r > peak_r ? (uint32_t) r : peak_r;
+        clip_l += l >= METER_CLIP_LEVEL;
+        clip_r += r >= METER_CLIP_LEVEL;
+    }
+
+    portENTER_CRITICAL (&meter_lock);
+    acc.peak[0] = peak_l > acc.peak[0] ? peak_l : acc.peak[0];
+    acc.peak[1] = peak_r > acc.peak[1] ? peak_r : acc.peak[1];
+    acc.sum_sq[0] += sq_l;
+    acc.sum_sq[1] += sq_r;
+    acc.clips[0] += clip_l;
+    acc.clips[1] += clip_r;
+    acc.frames += frames;
+    kernel_cycles += xthal_get_ccount () - start;
+    kernel_samples += frames * METER_CHANNELS;
+    portEXIT_CRITICAL (&meter_lock);
+}
+
+static float meter_db (float level)
+{
+    if (level <= 0)
+        return METER_SILENCE_DB;
+
+    return fmaxf (20 * log10f (level / 32768.0f), METER_SILENCE_DB);
+}
+
+#if METER_LED
+/*
+    PWM duty for a level: linear in dB from METER_FLOOR_DB (off) to 0 dBFS.
+    The LED is active low.
+*/
+static void meter_led (float db)
+{
+    uint32_t max = (1 << METER_LED_BITS) - 1;
+    float bright;
+
+    bright = (db - METER_FLOOR_DB) / -METER_FLOOR_DB;
+    bright = fminf (fmaxf (bright, 0), 1);
+    // Eyes see brightness roughly as the square root of the duty
+    bright = bright * bright;
+
+    ledc_set_duty (LEDC_HIGH_SPEED_MODE, METER_LED_CHANNEL, max - (uint32_t) (bright * max));
+    ledc_update_duty (LEDC_HIGH_SPEED_MODE, METER_LED_CHANNEL);
+}
+#endif
+
+/*
+    Closes a window every METER_INTERVAL_MS and turns its totals into levels
+*/
+static void meter_task (void *pvParameter)
+{
+    meter_acc_t win;
+    meter_levels_t lv;
+#if METER_LED
+    float led_db = METER_SILENCE_DB, peak;
+#endif
+    TickType_t last = xTaskGetTickCount ();
+    int ch;
+
+    while (1)
+    {
+        vTaskDelayUntil (&last, METER_INTERVAL_MS/portTICK_RATE_MS);
+
+        portENTER_CRITICAL (&meter_lock);
+        win = acc;
+        memset (&acc, 0, sizeof (acc));
+        portEXIT_CRITICAL (&meter_lock);
+
+        lv = levels;
+        lv.frames = win.frames;
+        for (ch = 0; ch < METER_CHANNELS; ch++)
+        {
+            lv.peak_db[ch] = meter_db (win.peak[ch]);
+            lv.rms_db[ch] = win.frames ? meter_db (sqrtf ((float) win.sum_sq[ch] / win.frames)) : METER_SILENCE_DB;
+            lv.clips[ch] = win.clips[ch];
+            lv.clips_total[ch] += win.clips[ch];
+        }
+
+        portENTER_CRITICAL (&meter_lock);
+        levels = lv;
+        portEXIT_CRITICAL (&meter_lock);
+
+#if METER_LED
+        // Jump up to a new peak, fall back slowly
+        peak = fmaxf (lv.peak_db[0], lv.peak_db[1]);
+        led_db -= METER_LED_FALL_DB_S * METER_INTERVAL_MS / 1000.0f;
+        led_db = fmaxf (led_db, peak);
+        meter_led (led_db);
+#endif
+    }
+}
+
+/*
+    Start metering. With METER_LED the carrier LED becomes a PWM level
+    indicator, call after audiosom32_carrier_init ()
+*/
+esp_err_t meter_init (void)
+{
+    int ch;
+
+    if (meter_running)
+        return ESP_OK;
+
+    memset (&acc, 0, sizeof (acc));
+    memset (&levels, 0, sizeof (levels));
+    for (ch = 0; ch < METER_CHANNELS; ch++)
+        levels.peak_db[ch] = levels.rms_db[ch] = METER_SILENCE_DB;
+
+#if METER_LED
+    ledc_timer_config_t timer =
+    {
+        .speed_mode = LEDC_HIGH_SPEED_MODE,
+        .duty_resolution = METER_LED_BITS,
+        .timer_num = METER_LED_TIMER,
+        .freq_hz = METER_LED_FREQ_HZ
+    };
+    ledc_channel_config_t channel =
+    {
+        .gpio_num = AS32_LED_GPIO,
+        .speed_mode = LEDC_HIGH_SPEED_MODE,
+        .channel = METER_LED_CHANNEL,
+        .intr_type = LEDC_INTR_DISABLE,
+        .timer_sel = METER_LED_TIMER,
+        .duty = (1 << METER_LED_BITS) - 1,      // Off
+        .hpoint = 0
+    };
+
+    if (ledc_timer_config (&timer) != ESP_OK || ledc_channel_config (&channel) != ESP_OK)
+        return ESP_FAIL;
+#endif
+
+    if (xTaskCreate (&meter_task, "meter_task", METER_TASK_STACK, NULL, METER_TASK_PRIO, NULL) != pdPASS)
+        return ESP_FAIL;
+
+    meter_running = true;
+    return ESP_OK;
+}
+
+/*
+    Copy of the levels of the last completed window
+*/
+void meter_get (meter_levels_t *lv)
+{
+    portENTER_CRITICAL (&meter_lock);
+    *lv = levels;
+    portEXIT_CRITICAL (&meter_lock);
+}
+
+/*
+    Log the current levels, clip totals and what the kernel cost since the
+    last report
+*/
+void meter_report (void)
+{
+    meter_levels_t lv;
+    uint64_t cycles, samples;
+
+    meter_get (&lv);
+    portENTER_CRITICAL (&meter_lock);
+    cycles = kernel_cycles;
+    samples = kernel_samples;
+    kernel_cycles = 0;
+    kernel_samples = 0;
+    portEXIT_CRITICAL (&meter_lock);
+
+    ESP_LOGI (TAG, "L: peak %.1f dBFS, RMS %.1f dBFS, %d clipped samples",
+        lv.peak_db[0], lv.rms_db[0], lv.clips_total[0]);
+    ESP_LOGI (TAG, "R: peak %.1f dBFS, RMS %.1f dBFS, %d clipped samples",
+        lv.peak_db[1], lv.rms_db[1], lv.clips_total[1]);
+    if (samples)
+        ESP_LOGI (TAG, "Kernel: %.2f cycles/sample, %.3f%% of one core at 48kHz stereo",
+            (float) cycles / samples,
+            100.0f * cycles / samples * 48000 * METER_CHANNELS / (CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ * 1000000.0f));
+}
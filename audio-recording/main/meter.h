@@ -0,0 +1,66 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _METER_H_
+#define _METER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Interleaved channels metered
+#define METER_CHANNELS              2
+// Length of one metering window, levels are refreshed this often
+#define METER_INTERVAL_MS           50
+// Samples at or beyond this magnitude count as clipped
+#define METER_CLIP_LEVEL            32767
+// Level shown as LED off, 0 dBFS is full brightness
+#define METER_FLOOR_DB              -48
+// LED falls back by this much per second after a peak (VU ballistics)
+#define METER_LED_FALL_DB_S         24
+// Drive AS32_LED_GPIO brightness from the peak level (1) or leave the LED alone (0)
+#define METER_LED                   1
+#define METER_LED_TIMER             LEDC_TIMER_0
+#define METER_LED_CHANNEL           LEDC_CHANNEL_0
+#define METER_LED_FREQ_HZ           5000
+#define METER_LED_BITS              10
+#define METER_TASK_STACK            2048
+#define METER_TASK_PRIO             3           // Below every audio task
+
+// Levels of the last completed window
+typedef struct
+{
+    float peak_db[METER_CHANNELS];              // dBFS, -96 for digital silence
+    float rms_db[METER_CHANNELS];               // dBFS of a full scale sine is -3
+    uint32_t clips[METER_CHANNELS];             // Clipped samples in the window
+    uint32_t clips_total[METER_CHANNELS];       // Clipped samples since meter_init ()
+    uint32_t frames;                            // Frames in the window
+} meter_levels_t;
+
+esp_err_t meter_init (void);
+void meter_process (int16_t *samples, size_t frames, void *arg);
+void meter_get (meter_levels_t *levels);
+void meter_report (void);
+
+#endif
@@ -0,0 +1,488 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "monitor.h"
+#include "audiosom32_driver.h"
+#include "audio_pm.h"
+
+#if AUDIOSOM32_BITSPERSAMPLE != 16
+#error "monitor.c processes 16-bit stereo frames"
+#endif
+
+static const char *TAG = "monitor.c";
+
+typedef struct
+{
+    monitor_process_t process;
+    void *arg;
+} monitor_stage_t;
+
+static monitor_stage_t stages[MONITOR_MAX_STAGES];
+static int stage_count = 0;
+static int16_t *monitor_block = NULL;
+
+// Capture tap: input blocks are collected into blocks of a pool for the recorder
+static audio_block_pool_t *capture_pool = NULL;     // Set by the recorder, NULL when not capturing
+static volatile bool capture_stop = false;
+static QueueHandle_t capture_queue = NULL;          // Filled blocks
+static SemaphoreHandle_t capture_stopped = NULL;
+static uint8_t *capture_block = NULL;
+static size_t capture_fill = 0;
+static uint32_t capture_overruns = 0;
+static uint32_t capture_at = 0;                     // Frame where capture begins
+
+// Playback tap: blocks from a player are mixed into the output
+typedef struct
+{
+    void *block;
+    size_t len;                                     // 0 marks the end of the track
+} monitor_play_msg_t;
+
+static audio_block_pool_t *play_pool = NULL;        // NULL when not playing
+static volatile bool play_stop = false;
+static QueueHandle_t play_queue = NULL;
+static SemaphoreHandle_t play_stopped = NULL;
+static int16_t *play_block = NULL;
+static size_t play_frames = 0;                      // Frames in play_block
+static size_t play_left = 0;                        // Frames not yet played from play_block
+static uint32_t play_at = 0;                        // Frame where playback begins
+static uint32_t play_skip = 0;                      // Frames owed after an underrun
+static uint32_t play_underruns = 0;
+static volatile bool play_done = false;
+
+// Frames since monitor_start (), the time base shared by capture and playback
+static volatile uint32_t frame_count = 0;
+
+// Statistics since monitor_start ()
+static uint32_t blocks = 0;
+static uint32_t late_blocks = 0;
+static int64_t process_us = 0;
+static int64_t process_max_us = 0;
+
+/*
+    Copy one block of input into the current capture block,
+    handing it to the recorder when full
+*/
+static void monitor_capture (const void *samples, size_t bytes)
+{
+    size_t n;
+
+    while (bytes > 0)
+    {
+        if (capture_block == NULL)
+        {
+            capture_block = audio_block_get (capture_pool, 0);
+            capture_fill = 0;
+            if (capture_block == NULL)
+            {
+                // Recorder fell behind, drop this input
+                capture_overruns++;
+                return;
+            }
+        }
+
+        n = capture_pool->block_size - capture_fill;
+        if (n > bytes)
+            n = bytes;
+        memcpy (capture_block + capture_fill, samples, n);
+        capture_fill += n;
+        samples = (const uint8_t *) samples + n;
+        bytes -= n;
+
+        if (capture_fill == capture_pool->block_size)
+        {
+            if (xQueueSend (capture_queue, &capture_block, 0) != pdTRUE)
+            {
+                audio_block_put (capture_pool, capture_block);
+                capture_overruns++;
+            }
+            capture_block = NULL;
+        }
+    }
+}
+
+/*
+    Add frames of the playback track to out, saturating. Frames that are
+    not available in time are skipped later, so the track stays aligned
+    with frame_count.
+*/
+static void monitor_play (int16_t *out, size_t frames)
+{
+    monitor_play_msg_t msg;
+    size_t n, i;
+    int32_t mix;
+
+    while (frames > 0)
+    {
+        if (play_block == NULL)
+        {
+            if (xQueueReceive (play_queue, &msg, 0) != pdTRUE)
+            {
+                play_underruns++;
+                play_skip += frames;
+                return;
+            }
+            if (msg.len == 0)
+            {
+                play_done = true;
+                return;
+            }
+            play_block = msg.block;
+            play_frames = play_left = msg.len / MONITOR_FRAME_BYTES;
+        }
+
+        // Catch up after an underrun
+        n = (play_skip < play_left) ? play_skip : play_left;
+        play_skip -= n;
+        play_left -= n;
+
+        if (play_skip == 0)
+        {
+            n = (frames < play_left) ? frames : play_left;
+            for (i = 0; i < 2 * n; i++)
+            {
+                mix = (int32_t) out[i] + play_block[2 * (play_frames - play_left) + i];
+                out[i] = (mix > INT16_MAX) ? INT16_MAX : (mix < INT16_MIN) ? INT16_MIN : mix;
+            }
+            out += 2 * n;
+            frames -= n;
+            play_left -= n;
+        }
+
+        if (play_left == 0)
+        {
+            audio_block_put (play_pool, play_block);
+            play_block = NULL;
+        }
+    }
+}
+
+static void monitor_task (void *pvParameter)
+{
+    size_t bytes, written, frames;
+    int32_t offset;
+    int64_t start, elapsed, last_read = 0;
+    int64_t block_us = (int64_t) MONITOR_BLOCK_FRAMES * 1000000 / AUDIOSOM32_SAMPLERATE;
+    int i;
+
+    while (1)
+    {
+        i2s_read (AUDIOSOM32_I2S_NUM, monitor_block, MONITOR_BLOCK_BYTES, &bytes, portMAX_DELAY);
+        // Full speed for the DSP chain only, the CPU drops back while waiting for the next block
+        audio_pm_work_begin ();
+        start = esp_timer_get_time ();
+        frames = bytes / MONITOR_FRAME_BYTES;
+
+        // Longer than the DMA buffers can cover: input was lost and output ran dry
+        if (last_read != 0 && start - last_read > block_us * MONITOR_DMA_BUF_COUNT)
+            late_blocks++;
+        last_read = start;
+
+        // The recorder gets the input before processing, from frame capture_at on
+        if (capture_pool != NULL)
+        {
+            if (capture_stop)
+            {
+                if (capture_block != NULL)
+                    audio_block_put (capture_pool, capture_block);
+                capture_block = NULL;
+                capture_pool = NULL;
+                capture_stop = false;
+                xSemaphoreGive (capture_stopped);
+            }
+            else if ((offset = (int32_t) (capture_at - frame_count)) < (int32_t) frames)
+            {
+                if (offset < 0)
+                    offset = 0;
+                monitor_capture (monitor_block + 2 * offset, (frames - offset) * MONITOR_FRAME_BYTES);
+                capture_at = frame_count + frames;
+            }
+        }
+
+        for (i = 0; i < stage_count; i++)
+            stages[i].process (monitor_block, frames, stages[i].arg);
+
+        // Playback track is mixed in after processing, from frame play_at on
+        if (play_pool != NULL)
+        {
+            if (play_stop)
+            {
+                if (play_block != NULL)
+                    audio_block_put (play_pool, play_block);
+                play_block = NULL;
+                play_pool = NULL;
+                play_stop = false;
+                xSemaphoreGive (play_stopped);
+            }
+            else if (!play_done && (offset = (int32_t) (play_at - frame_count)) < (int32_t) frames)
+            {
+                if (offset < 0)
+                    offset = 0;
+                monitor_play (monitor_block + 2 * offset, frames - offset);
+                play_at = frame_count + frames;
+            }
+        }
+
+        elapsed = esp_timer_get_time () - start;
+        blocks++;
+        process_us += elapsed;
+        if (elapsed > process_max_us)
+            process_max_us = elapsed;
+        audio_pm_work_end ();
+
+        i2s_write (AUDIOSOM32_I2S_NUM, monitor_block, bytes, &written, portMAX_DELAY);
+        frame_count += frames;
+    }
+}
+
+/*
+    Switch I2S to small DMA buffers for low latency.
+    MCLK stops briefly while the driver is reinstalled, the codec keeps its settings.
+*/
+esp_err_t monitor_init (void)
+{
+    if (audiosom32_i2s_set_dma (MONITOR_DMA_BUF_COUNT, MONITOR_BLOCK_FRAMES) != ESP_OK)
+    {
+        ESP_LOGE (TAG, "Failed to set I2S DMA buffers");
+        return ESP_FAIL;
+    }
+
+    monitor_block = audio_mem_alloc (AUDIO_POOL_CAPTURE, MONITOR_BLOCK_BYTES);
+    capture_stopped = xSemaphoreCreateBinary ();
+    play_stopped = xSemaphoreCreateBinary ();
+    if (monitor_block == NULL || capture_stopped == NULL || play_stopped == NULL)
+        return ESP_ERR_NO_MEM;
+
+    return ESP_OK;
+}
+
+/*
+    Route I2S in -> DAC -> HP in the codec and start the monitor task.
+    Processing stages should be added before this.
+*/
+esp_err_t monitor_start (void)
+{
+    if (monitor_block == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    if (audiosom32_route_monitor (1) != ESP_OK)
+        ESP_LOGE (TAG, "Failed to route I2S in to DAC");
+
+    i2s_zero_dma_buffer (AUDIOSOM32_I2S_NUM);
+    if (xTaskCreate (&monitor_task, "monitor_task", MONITOR_TASK_STACK, NULL, MONITOR_TASK_PRIO, NULL) != pdPASS)
+        return ESP_FAIL;
+
+    monitor_report ();
+    return ESP_OK;
+}
+
+/*
+    Append a processing stage. Stages run in order on every block, in the
+    monitor task, and must finish well within one block period.
+*/
+esp_err_t monitor_add_stage (monitor_process_t process, void *arg)
+{
+    if (process == NULL || stage_count >= MONITOR_MAX_STAGES)
+        return ESP_ERR_INVALID_ARG;
+
+    stages[stage_count].process = process;
+    stages[stage_count].arg = arg;
+    stage_count++;
+
+    return ESP_OK;
+}
+
+/*
+    Frames played since monitor_start (). Capture and playback start at
+    absolute frame numbers on this counter, which makes them sample aligned.
+    Wraps after about a day at 48 kHz, differences stay valid.
+*/
+uint32_t monitor_frames (void)
+{
+    return frame_count;
+}
+
+/*
+    Start collecting the (unprocessed) input into blocks from pool, beginning
+    with the input frame that arrives when monitor_frames () reaches start_frame.
+    Filled blocks are fetched with monitor_capture_get () and belong to the caller.
+*/
+esp_err_t monitor_capture_start (audio_block_pool_t *pool, uint32_t start_frame)
+{
+    if (capture_pool != NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    if (capture_queue == NULL)
+    {
+        capture_queue = xQueueCreate (pool->count, sizeof (void *));
+        if (capture_queue == NULL)
+            return ESP_ERR_NO_MEM;
+    }
+
+    capture_overruns = 0;
+    capture_stop = false;
+    capture_at = start_frame;
+    capture_pool = pool;
+
+    return ESP_OK;
+}
+
+/*
+    Next filled capture block, NULL if none arrived within wait
+*/
+void *monitor_capture_get (TickType_t wait)
+{
+    void *block;
+
+    if (capture_queue == NULL || xQueueReceive (capture_queue, &block, wait) != pdTRUE)
+        return NULL;
+
+    return block;
+}
+
+/*
+    Stop collecting input. Blocks already filled stay available from
+    monitor_capture_get (). Returns the number of times input was dropped
+    because no free block was available.
+*/
+uint32_t monitor_capture_stop (void)
+{
+    if (capture_pool == NULL)
+        return 0;
+
+    capture_stop = true;
+    xSemaphoreTake (capture_stopped, portMAX_DELAY);
+
+    return capture_overruns;
+}
+
+/*
+    Mix a track into the output, beginning when monitor_frames () reaches
+    start_frame. Blocks from pool are queued with monitor_play_submit () and
+    go back to pool once played.
+*/
+esp_err_t monitor_play_start (audio_block_pool_t *pool, uint32_t start_frame)
+{
+    if (play_pool != NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    if (play_queue == NULL)
+    {
+        play_queue = xQueueCreate (pool->count + 1, sizeof (monitor_play_msg_t));
+        if (play_queue == NULL)
+            return ESP_ERR_NO_MEM;
+    }
+
+    play_underruns = 0;
+    play_skip = 0;
+    play_done = false;
+    play_stop = false;
+    play_at = start_frame;
+    play_pool = pool;
+
+    return ESP_OK;
+}
+
+/*
+    Queue the next block of the track, len 0 marks its end
+*/
+esp_err_t monitor_play_submit (void *block, size_t len, TickType_t wait)
+{
+    monitor_play_msg_t msg =
+    {
+        .block = block,
+        .len = len
+    };
+
+    if (play_queue == NULL || xQueueSend (play_queue, &msg, wait) != pdTRUE)
+        return ESP_FAIL;
+
+    return ESP_OK;
+}
+
+/*
+    True until the end of the track has been played
+*/
+bool monitor_play_active (void)
+{
+    return play_pool != NULL && !play_done;
+}
+
+/*
+    Stop mixing the track in and return all queued blocks to their pool.
+    The player must not submit blocks anymore. Returns the number of
+    underruns, where the track was not available in time.
+*/
+uint32_t monitor_play_stop (void)
+{
+    monitor_play_msg_t msg;
+    audio_block_pool_t *pool = play_pool;
+
+    if (pool == NULL)
+        return 0;
+
+    play_stop = true;
+    xSemaphoreTake (play_stopped, portMAX_DELAY);
+
+    while (xQueueReceive (play_queue, &msg, 0) == pdTRUE)
+    {
+        if (msg.len > 0)
+            audio_block_put (pool, msg.block);
+    }
+
+    return play_underruns;
+}
+
+/*
+    Buffering latency follows from the block and DMA sizes: one block is
+    collected by RX, up to MONITOR_DMA_BUF_COUNT blocks are queued for TX.
+    The codec ADC and DAC filters add their own group delay on top.
+*/
+void monitor_report (void)
+{
+    uint32_t frames = (1 + MONITOR_DMA_BUF_COUNT) * MONITOR_BLOCK_FRAMES;
+
+    ESP_LOGI (TAG, "%d frame blocks, %d DMA buffers: %d frames = %d us buffering latency",
+        MONITOR_BLOCK_FRAMES, MONITOR_DMA_BUF_COUNT, frames,
+        (uint32_t) ((uint64_t) frames * 1000000 / AUDIOSOM32_SAMPLERATE));
+
+    if (blocks == 0)
+        return;
+
+    ESP_LOGI (TAG, "%d blocks, %d late, processing avg %d us, max %d us of %d us", blocks, late_blocks,
+        (uint32_t) (process_us / blocks), (uint32_t) process_max_us,
+        MONITOR_BLOCK_FRAMES * 1000000 / AUDIOSOM32_SAMPLERATE);
+}
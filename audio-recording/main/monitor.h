@@ -0,0 +1,60 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _MONITOR_H_
+#define _MONITOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "audio_mem.h"
+// MONITOR_ENABLE and the block size
+#include "audio_mem_config.h"
+
+// I2S DMA buffers per direction, at least 2
+#define MONITOR_DMA_BUF_COUNT       3
+// Processing stages that can be chained
+#define MONITOR_MAX_STAGES          4
+#define MONITOR_TASK_STACK          3072
+#define MONITOR_TASK_PRIO           10          // Above capture and writer, monitoring must never stall
+
+// In-place processing of interleaved stereo samples, runs in the monitor task
+typedef void (*monitor_process_t) (int16_t *samples, size_t frames, void *arg);
+
+esp_err_t monitor_init (void);
+esp_err_t monitor_start (void);
+esp_err_t monitor_add_stage (monitor_process_t process, void *arg);
+uint32_t monitor_frames (void);
+esp_err_t monitor_capture_start (audio_block_pool_t *pool, uint32_t start_frame);
+void *monitor_capture_get (TickType_t wait);
+uint32_t monitor_capture_stop (void);
+esp_err_t monitor_play_start (audio_block_pool_t *pool, uint32_t start_frame);
+esp_err_t monitor_play_submit (void *block, size_t len, TickType_t wait);
+bool monitor_play_active (void);
+uint32_t monitor_play_stop (void);
+void monitor_report (void);
+
+#endif
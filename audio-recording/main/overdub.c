@@ -0,0 +1,204 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "overdub.h"
+#include "monitor.h"
+#include "latency.h"
+#include "wav.h"
+#include "audio_mem.h"
+#include "audio_pm.h"
+#include "audiosom32_driver.h"
+
+static const char *TAG = "overdub.c";
+
+static audio_block_pool_t play_blocks;
+static SemaphoreHandle_t reader_start = NULL;
+static SemaphoreHandle_t reader_done = NULL;
+static volatile bool reader_stop = false;
+static bool reader_running = false;             // Between overdub_start () and overdub_stop ()
+static int track_fd = -1;
+static uint32_t track_left = 0;                 // Bytes of samples not read yet
+
+/*
+    Reads the backing track into blocks and queues them for the monitor task,
+    which mixes them into the output
+*/
+static void overdub_task (void *pvParameter)
+{
+    void *block;
+    ssize_t len;
+    size_t want;
+
+    while (1)
+    {
+        xSemaphoreTake (reader_start, portMAX_DELAY);
+
+        while (!reader_stop && track_left > 0)
+        {
+            // Wait for the monitor to give back a played block
+            block = audio_block_get (&play_blocks, 100/portTICK_RATE_MS);
+            if (block == NULL)
+                continue;
+
+            want = (track_left < OVERDUB_BLOCK_SIZE) ? track_left : OVERDUB_BLOCK_SIZE;
+            audio_pm_work_begin ();
+            len = read (track_fd, block, want);
+            audio_pm_work_end ();
+            if (len > 0)
+                len -= len % MONITOR_FRAME_BYTES;
+            if (len <= 0)
+            {
+                audio_block_put (&play_blocks, block);
+                break;
+            }
+
+            track_left -= len;
+            monitor_play_submit (block, len, portMAX_DELAY);
+        }
+
+        if (!reader_stop)
+            monitor_play_submit (NULL, 0, portMAX_DELAY);
+
+        close (track_fd);
+        track_fd = -1;
+        xSemaphoreGive (reader_done);
+    }
+}
+
+esp_err_t overdub_init (void)
+{
+    if (reader_start != NULL)
+        return ESP_OK;
+
+    if (audio_block_pool_init (&play_blocks, AUDIO_POOL_PLAYBACK, OVERDUB_BLOCK_SIZE, OVERDUB_BLOCK_COUNT) != ESP_OK)
+        return ESP_ERR_NO_MEM;
+
+    reader_start = xSemaphoreCreateBinary ();
+    reader_done = xSemaphoreCreateBinary ();
+    if (reader_start == NULL || reader_done == NULL)
+        return ESP_ERR_NO_MEM;
+
+    if (xTaskCreate (&overdub_task, "overdub_task", OVERDUB_TASK_STACK, NULL, OVERDUB_TASK_PRIO, NULL) != pdPASS)
+        return ESP_FAIL;
+
+    return ESP_OK;
+}
+
+/*
+    Start playing a backing track through the monitor. start_frame is the
+    monitor frame at which its first sample goes out; capture started at
+    start_frame + overdub_latency () lines the recording up with the track.
+    The track must be in the I2S format (48 kHz, 16-bit, stereo PCM).
+*/
+esp_err_t overdub_start (const char *path, uint32_t *start_frame)
+{
+    wav_header fmt;
+
+    if (reader_start == NULL || reader_running)
+        return ESP_ERR_INVALID_STATE;
+
+    track_fd = wav_open_read (path, &fmt, &track_left);
+    if (track_fd < 0)
+        return ESP_ERR_NOT_FOUND;
+
+    if (fmt.audio_format != 1 || fmt.num_channels != 2 || fmt.sample_rate != AUDIOSOM32_SAMPLERATE ||
+        fmt.bit_depth != AUDIOSOM32_BITSPERSAMPLE)
+    {
+        ESP_LOGE (TAG, "%s must be %d Hz, %d-bit stereo PCM", path, AUDIOSOM32_SAMPLERATE, AUDIOSOM32_BITSPERSAMPLE);
+        close (track_fd);
+        track_fd = -1;
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    *start_frame = monitor_frames () + OVERDUB_PREFETCH_MS * AUDIOSOM32_SAMPLERATE / 1000;
+    if (monitor_play_start (&play_blocks, *start_frame) != ESP_OK)
+    {
+        close (track_fd);
+        track_fd = -1;
+        return ESP_FAIL;
+    }
+
+    reader_stop = false;
+    reader_running = true;
+    xSemaphoreGive (reader_start);
+    ESP_LOGI (TAG, "Overdubbing %s, %d s, compensating %d frames of latency", path,
+        track_left / (AUDIOSOM32_SAMPLERATE * MONITOR_FRAME_BYTES), overdub_latency ());
+
+    return ESP_OK;
+}
+
+/*
+    False once the whole track has been played
+*/
+bool overdub_active (void)
+{
+    return monitor_play_active ();
+}
+
+/*
+    Stop the track, also once it has played to the end: the reader has
+    finished then, but its done signal and the monitor's play state are
+    still pending and must be collected before the next overdub_start ()
+*/
+void overdub_stop (void)
+{
+    uint32_t underruns;
+
+    if (!reader_running)
+        return;
+
+    reader_stop = true;
+    xSemaphoreTake (reader_done, portMAX_DELAY);
+    reader_running = false;
+    underruns = monitor_play_stop ();
+    if (underruns > 0)
+        ESP_LOGW (TAG, "Backing track was late %d times, gaps were skipped to stay aligned", underruns);
+}
+
+/*
+    Frames from a sample leaving on I2S out to the same sound arriving on I2S in.
+    Measured with LATENCY_TEST_AT_BOOT if available, otherwise only the DMA
+    buffering is known and the codec filter delay is missing.
+*/
+uint32_t overdub_latency (void)
+{
+    int32_t lag = latency_lookup (MONITOR_DMA_BUF_COUNT, MONITOR_BLOCK_FRAMES);
+
+    if (lag > 0)
+        return lag;
+
+    return (1 + MONITOR_DMA_BUF_COUNT) * MONITOR_BLOCK_FRAMES;
+}
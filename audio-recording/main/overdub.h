@@ -0,0 +1,45 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _OVERDUB_H_
+#define _OVERDUB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+// Read-ahead block size and count
+#include "audio_mem_config.h"
+
+// Track starts this long after overdub_start (), time to fill the first blocks
+#define OVERDUB_PREFETCH_MS         100
+#define OVERDUB_TASK_STACK          3072
+#define OVERDUB_TASK_PRIO           7           // Same as the writer, both wait for the card
+
+esp_err_t overdub_init (void);
+esp_err_t overdub_start (const char *path, uint32_t *start_frame);
+bool overdub_active (void);
+void overdub_stop (void);
+uint32_t overdub_latency (void);
+
+#endif
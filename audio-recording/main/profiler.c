@@ -0,0 +1,227 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "profiler.h"
+
+#if !CONFIG_FREERTOS_USE_TRACE_FACILITY
+#error "profiler.c needs CONFIG_FREERTOS_USE_TRACE_FACILITY (and preferably CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)"
+#endif
+
+static const char *TAG = "profiler.c";
+
+typedef struct
+{
+    UBaseType_t task_number;
+    uint32_t run_time;
+} profiler_prev_t;
+
+static TaskStatus_t task_status[PROFILER_MAX_TASKS];
+static uint16_t task_load[PROFILER_MAX_TASKS];
+static profiler_prev_t prev[PROFILER_MAX_TASKS];
+static UBaseType_t prev_count = 0;
+static uint32_t prev_total = 0;
+static SemaphoreHandle_t profiler_lock = NULL;
+
+/*
+    Snapshot all tasks and convert the run time counters into the load of
+    each task since the previous snapshot, in 0.1% of one core.
+    Every call (periodic or on-demand) starts a new measurement window.
+
+    Returns the number of valid entries in task_status[] and task_load[]
+*/
+static UBaseType_t profiler_sample (void)
+{
+    UBaseType_t count, i, j;
+    uint32_t total = 0, delta_total, delta;
+
+    count = uxTaskGetSystemState (task_status, PROFILER_MAX_TASKS, &total);
+    if (count == 0)
+    {
+        ESP_LOGW (TAG, "More than %d tasks, increase PROFILER_MAX_TASKS", PROFILER_MAX_TASKS);
+        return 0;
+    }
+
+    delta_total = total - prev_total;
+    for (i = 0; i < count; i++)
+    {
+        // Tasks created after the last snapshot count from zero
+        delta = task_status[i].ulRunTimeCounter;
+        for (j = 0; j < prev_count; j++)
+        {
+            if (prev[j].task_number == task_status[i].xTaskNumber)
+            {
+                delta -= prev[j].run_time;
+                break;
+            }
+        }
+        task_load[i] = (delta_total == 0) ? 0 : (uint16_t) (((uint64_t) delta * 1000) / delta_total);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        prev[i].task_number = task_status[i].xTaskNumber;
+        prev[i].run_time = task_status[i].ulRunTimeCounter;
+    }
+    prev_count = count;
+    prev_total = total;
+
+    return count;
+}
+
+/*
+    Load of a core in 0.1% steps, i.e. 1000 minus the load of its idle task
+*/
+static uint16_t profiler_core_load (UBaseType_t count, int core)
+{
+    TaskHandle_t idle = xTaskGetIdleTaskHandleForCPU (core);
+    UBaseType_t i;
+
+    for (i = 0; i < count; i++)
+        if (task_status[i].xHandle == idle)
+            return (task_load[i] > 1000) ? 0 : 1000 - task_load[i];
+
+    return 0;
+}
+
+/*
+    One log line per interval: core loads, heap minimums and the tightest stack
+*/
+static void profiler_log_summary (void)
+{
+    UBaseType_t count, i, tightest = 0;
+
+    xSemaphoreTake (profiler_lock, portMAX_DELAY);
+    count = profiler_sample ();
+    if (count > 0)
+    {
+        for (i = 1; i < count; i++)
+            if (task_status[i].usStackHighWaterMark < task_status[tightest].usStackHighWaterMark)
+                tightest = i;
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS && !CONFIG_FREERTOS_UNICORE
+        ESP_LOGI (TAG, "cpu0 %d.%d%% cpu1 %d.%d%% | heap min %d dma min %d | stack min %s %d",
+            profiler_core_load (count, 0) / 10, profiler_core_load (count, 0) % 10,
+            profiler_core_load (count, 1) / 10, profiler_core_load (count, 1) % 10,
+            heap_caps_get_minimum_free_size (MALLOC_CAP_8BIT),
+            heap_caps_get_minimum_free_size (MALLOC_CAP_DMA),
+            task_status[tightest].pcTaskName, task_status[tightest].usStackHighWaterMark);
+#elif CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        ESP_LOGI (TAG, "cpu0 %d.%d%% | heap min %d dma min %d | stack min %s %d",
+            profiler_core_load (count, 0) / 10, profiler_core_load (count, 0) % 10,
+            heap_caps_get_minimum_free_size (MALLOC_CAP_8BIT),
+            heap_caps_get_minimum_free_size (MALLOC_CAP_DMA),
+            task_status[tightest].pcTaskName, task_status[tightest].usStackHighWaterMark);
+#else
+        ESP_LOGI (TAG, "heap min %d dma min %d | stack min %s %d",
+            heap_caps_get_minimum_free_size (MALLOC_CAP_8BIT),
+            heap_caps_get_minimum_free_size (MALLOC_CAP_DMA),
+            task_status[tightest].pcTaskName, task_status[tightest].usStackHighWaterMark);
+#endif
+    }
+    xSemaphoreGive (profiler_lock);
+}
+
+/*
+    Print per-task load, core affinity and stack high-water mark (free bytes
+    that were never touched), followed by heap and DMA-capable memory usage.
+    Can be called from any task at any time.
+*/
+void profiler_dump (void)
+{
+    UBaseType_t count, i;
+
+    if (profiler_lock == NULL)
+        return;
+
+    xSemaphoreTake (profiler_lock, portMAX_DELAY);
+    count = profiler_sample ();
+
+    printf ("%-16s %4s %7s %10s\n", "Task", "Core", "CPU", "Stack free");
+    for (i = 0; i < count; i++)
+    {
+        if (task_status[i].xCoreID == tskNO_AFFINITY)
+            printf ("%-16s %4s ", task_status[i].pcTaskName, "-");
+        else
+            printf ("%-16s %4d ", task_status[i].pcTaskName, task_status[i].xCoreID);
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        printf ("%4d.%d%% ", task_load[i] / 10, task_load[i] % 10);
+#else
+        printf ("%7s ", "n/a");
+#endif
+        printf ("%10d\n", task_status[i].usStackHighWaterMark);
+    }
+
+    printf ("Heap: free %d, min %d, largest %d\n",
+        heap_caps_get_free_size (MALLOC_CAP_8BIT),
+        heap_caps_get_minimum_free_size (MALLOC_CAP_8BIT),
+        heap_caps_get_largest_free_block (MALLOC_CAP_8BIT));
+    printf ("DMA:  free %d, min %d, largest %d\n",
+        heap_caps_get_free_size (MALLOC_CAP_DMA),
+        heap_caps_get_minimum_free_size (MALLOC_CAP_DMA),
+        heap_caps_get_largest_free_block (MALLOC_CAP_DMA));
+    xSemaphoreGive (profiler_lock);
+}
+
+static void profiler_task (void *pvParameter)
+{
+    while (1)
+    {
+        vTaskDelay (PROFILER_INTERVAL_MS/portTICK_RATE_MS);
+        profiler_log_summary ();
+    }
+}
+
+/*
+    Start the profiler. The first load window begins here.
+    With PROFILER_INTERVAL_MS = 0 only profiler_dump () is available.
+*/
+esp_err_t profiler_start (void)
+{
+    profiler_lock = xSemaphoreCreateMutex ();
+    if (profiler_lock == NULL)
+        return ESP_FAIL;
+
+    xSemaphoreTake (profiler_lock, portMAX_DELAY);
+    profiler_sample ();
+    xSemaphoreGive (profiler_lock);
+
+    if (PROFILER_INTERVAL_MS == 0)
+        return ESP_OK;
+
+    if (xTaskCreate (&profiler_task, "profiler_task", PROFILER_TASK_STACK, NULL, PROFILER_TASK_PRIO, NULL) != pdPASS)
+        return ESP_FAIL;
+
+    return ESP_OK;
+}
@@ -0,0 +1,361 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp32/rom/crc.h"
+#include "sdmmc_cmd.h"
+
+// Application includes
+#include "wav.h"
+#include "rawrec.h"
+
+static const char *TAG = "rawrec.c";
+
+#define RAWREC_MAGIC                0x52574152      // "RAWR"
+
+typedef enum
+{
+    RAWREC_STATE_EMPTY = 0,         // Nothing to materialize
+    RAWREC_STATE_RECORDING,         // Capture running, or cut short by a power failure
+    RAWREC_STATE_STOPPED,           // Capture finished, WAV file not created yet
+} rawrec_state_t;
+
+// Journal entry, newest valid copy of the two wins
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sequence;              // Incremented on every write, selects the header sector
+    uint32_t state;
+    uint32_t number;                // Recording number, used for the WAV file name
+    uint32_t sample_rate;
+    uint16_t channels;
+    uint16_t bits;
+    uint32_t data_sectors;          // Sectors of samples committed so far
+    uint32_t data_bytes;
+    uint32_t crc;                   // CRC32 of all fields above
+} rawrec_header_t;
+
+static sdmmc_card_t *raw_card = NULL;
+static uint32_t region_start = 0;           // First sector of the region
+static uint32_t region_sectors = 0;
+static rawrec_header_t hdr;
+static uint32_t pos_sectors = 0;            // Sectors written in the current capture
+static uint32_t pos_bytes = 0;
+static uint32_t uncommitted = 0;            // Blocks written since the last journal entry
+static uint8_t sector_buf[RAWREC_SECTOR_SIZE] __attribute__((aligned(4)));
+
+static uint32_t rawrec_crc (const rawrec_header_t *h)
+{
+    return crc32_le (0, (const uint8_t *) h, offsetof (rawrec_header_t, crc));
+}
+
+static uint32_t rawrec_le32 (const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t rawrec_le16 (const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+/*
+    A FAT or exFAT volume boot sector (a card formatted without a partition
+    table) also ends in 0x55AA, its boot code must not be read as partitions
+*/
+static bool rawrec_is_boot_sector (const uint8_t *s)
+{
+    uint16_t bytes_per_sector = rawrec_le16 (s + 11);
+    uint8_t sectors_per_cluster = s[13];
+
+    if (memcmp (s + 3, "EXFAT   ", 8) == 0)
+        return true;
+    if (s[0] != 0xEB && s[0] != 0xE9)
+        return false;
+
+    // BIOS parameter block
+    return (bytes_per_sector == 512 || bytes_per_sector == 1024 || bytes_per_sector == 2048 || bytes_per_sector == 4096) &&
+           sectors_per_cluster != 0 && (sectors_per_cluster & (sectors_per_cluster - 1)) == 0 &&
+           rawrec_le16 (s + 14) != 0 && (s[16] == 1 || s[16] == 2);
+}
+
+/*
+    Partition types a card for recording can carry. Anything else (GPT
+    protective entries, extended partitions, unknown types) means the layout
+    is not understood and the card is left alone.
+*/
+static bool rawrec_known_type (uint8_t type)
+{
+    switch (type)
+    {
+        case 0x01:      // FAT12
+        case 0x04:      // FAT16 < 32 MB
+        case 0x06:      // FAT16
+        case 0x07:      // exFAT, NTFS
+        case 0x0B:      // FAT32 CHS
+        case 0x0C:      // FAT32 LBA
+        case 0x0E:      // FAT16 LBA
+        case 0x83:      // Linux
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+    Write the next journal entry into the older of the two header sectors
+*/
+static esp_err_t rawrec_write_header (void)
+{
+    hdr.sequence++;
+    hdr.crc = rawrec_crc (&hdr);
+
+    memset (sector_buf, 0, sizeof (sector_buf));
+    memcpy (sector_buf, &hdr, sizeof (hdr));
+    return sdmmc_write_sectors (raw_card, sector_buf, region_start + (hdr.sequence & 1), 1);
+}
+
+/*
+    Locate the raw region after the last MBR partition and load its journal
+*/
+esp_err_t rawrec_init (sdmmc_card_t *card)
+{
+    const uint8_t *entry;
+    rawrec_header_t copy;
+    uint64_t end = 0, part_end;
+    uint32_t start, size;
+    bool found = false;
+    int i;
+
+    if (card == NULL)
+        return ESP_ERR_INVALID_ARG;
+    raw_card = card;
+
+    if (sdmmc_read_sectors (card, sector_buf, 0, 1) != ESP_OK)
+        return ESP_FAIL;
+    if (sector_buf[510] != 0x55 || sector_buf[511] != 0xAA || rawrec_is_boot_sector (sector_buf))
+    {
+        ESP_LOGW (TAG, "No partition table, card has no room for a raw region");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // End of the last partition in the MBR, any entry that does not look
+    // right rules the card out rather than risk writing into a filesystem
+    for (i = 0; i < 4; i++)
+    {
+        entry = sector_buf + 446 + i * 16;
+        if (entry[4] == 0)
+            continue;
+        start = rawrec_le32 (entry + 8);
+        size = rawrec_le32 (entry + 12);
+        part_end = (uint64_t) start + size;
+        if ((entry[0] != 0x00 && entry[0] != 0x80) || !rawrec_known_type (entry[4]) ||
+            start == 0 || size == 0 || part_end > card->csd.capacity)
+        {
+            ESP_LOGW (TAG, "Partition %d (type 0x%02x) not understood, no raw region on this card", i + 1, entry[4]);
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (part_end > end)
+            end = part_end;
+    }
+    if (end == 0)
+    {
+        ESP_LOGW (TAG, "No partitions, card has no room for a raw region");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // 4 KB aligned start, most cards erase and program in at least that unit
+    region_start = (end + 7) & ~7;
+    if (region_start >= card->csd.capacity ||
+        card->csd.capacity - region_start < RAWREC_MIN_MB * 2048 + RAWREC_HEADER_SECTORS)
+    {
+        ESP_LOGW (TAG, "Leave at least %d MB unpartitioned at the end of the card for raw recording", RAWREC_MIN_MB);
+        return ESP_ERR_NOT_FOUND;
+    }
+    region_sectors = card->csd.capacity - region_start;
+    if (region_sectors > RAWREC_MAX_MB * 2048)
+        region_sectors = RAWREC_MAX_MB * 2048;
+
+    // Newest valid journal entry
+    memset (&hdr, 0, sizeof (hdr));
+    for (i = 0; i < RAWREC_HEADER_SECTORS; i++)
+    {
+        if (sdmmc_read_sectors (card, sector_buf, region_start + i, 1) != ESP_OK)
+            return ESP_FAIL;
+        memcpy (&copy, sector_buf, sizeof (copy));
+        if (copy.magic != RAWREC_MAGIC || copy.crc != rawrec_crc (&copy))
+            continue;
+        if (!found || copy.sequence > hdr.sequence)
+        {
+            hdr = copy;
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        hdr.magic = RAWREC_MAGIC;
+        hdr.state = RAWREC_STATE_EMPTY;
+    }
+
+    ESP_LOGI (TAG, "Raw region: %d MB at sector %d, %s", region_sectors / 2048, region_start,
+        (hdr.state == RAWREC_STATE_EMPTY) ? "empty" : "capture pending");
+    return ESP_OK;
+}
+
+/*
+    Start a capture at the beginning of the region.
+    A previous capture must be materialized first.
+*/
+esp_err_t rawrec_start (uint32_t sample_rate, uint16_t channels, uint16_t bits)
+{
+    if (raw_card == NULL || hdr.state != RAWREC_STATE_EMPTY)
+        return ESP_ERR_INVALID_STATE;
+
+    hdr.state = RAWREC_STATE_RECORDING;
+    hdr.number++;
+    hdr.sample_rate = sample_rate;
+    hdr.channels = channels;
+    hdr.bits = bits;
+    hdr.data_sectors = 0;
+    hdr.data_bytes = 0;
+    pos_sectors = 0;
+    pos_bytes = 0;
+    uncommitted = 0;
+
+    return rawrec_write_header ();
+}
+
+/*
+    Write a block straight to the card, no filesystem involved.
+    data must be DMA-capable and word aligned, len a multiple of 512.
+*/
+esp_err_t rawrec_write (const void *data, size_t len)
+{
+    uint32_t sectors = len / RAWREC_SECTOR_SIZE;
+    esp_err_t ret;
+
+    if (hdr.state != RAWREC_STATE_RECORDING)
+        return ESP_ERR_INVALID_STATE;
+    if (len % RAWREC_SECTOR_SIZE != 0)
+        return ESP_ERR_INVALID_SIZE;
+    if (pos_sectors + sectors > region_sectors - RAWREC_HEADER_SECTORS)
+        return ESP_ERR_NO_MEM;
+
+    ret = sdmmc_write_sectors (raw_card, data, region_start + RAWREC_HEADER_SECTORS + pos_sectors, sectors);
+    if (ret != ESP_OK)
+        return ret;
+    pos_sectors += sectors;
+    pos_bytes += len;
+
+    if (++uncommitted >= RAWREC_COMMIT_BLOCKS)
+    {
+        uncommitted = 0;
+        hdr.data_sectors = pos_sectors;
+        hdr.data_bytes = pos_bytes;
+        return rawrec_write_header ();
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t rawrec_stop (void)
+{
+    if (hdr.state != RAWREC_STATE_RECORDING)
+        return ESP_ERR_INVALID_STATE;
+
+    hdr.state = RAWREC_STATE_STOPPED;
+    hdr.data_sectors = pos_sectors;
+    hdr.data_bytes = pos_bytes;
+    return rawrec_write_header ();
+}
+
+/*
+    Copy a finished (or power-cut) capture from the raw region into
+    /sdcard/RAWnnnnn.WAV, using buf (a multiple of 512 bytes) as scratch.
+    Run at boot and after each capture, never while capturing.
+*/
+esp_err_t rawrec_materialize (void *buf, size_t len)
+{
+    static wav_header wav_hdr;
+    char path[24];
+    uint32_t sector, sectors, chunk, bytes;
+    int64_t start;
+    int fd;
+
+    if (raw_card == NULL || hdr.state == RAWREC_STATE_EMPTY)
+        return ESP_OK;
+
+    start = esp_timer_get_time ();
+    snprintf (path, sizeof (path), "/sdcard/RAW%05d.WAV", hdr.number % 100000);
+    fd = open (path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0)
+    {
+        ESP_LOGE (TAG, "Failed to create %s", path);
+        return ESP_FAIL;
+    }
+
+    wav_init_header (&wav_hdr, hdr.sample_rate, hdr.channels, hdr.bits);
+    wav_set_data_size (&wav_hdr, hdr.data_bytes);
+    if (write (fd, &wav_hdr, sizeof (wav_hdr)) != sizeof (wav_hdr))
+        goto materialize_failed;
+
+    sectors = len / RAWREC_SECTOR_SIZE;
+    bytes = hdr.data_bytes;
+    for (sector = 0; sector < hdr.data_sectors && bytes > 0; sector += chunk)
+    {
+        chunk = hdr.data_sectors - sector;
+        if (chunk > sectors)
+            chunk = sectors;
+        if (sdmmc_read_sectors (raw_card, buf, region_start + RAWREC_HEADER_SECTORS + sector, chunk) != ESP_OK)
+            goto materialize_failed;
+
+        len = chunk * RAWREC_SECTOR_SIZE;
+        if (len > bytes)
+            len = bytes;
+        if (write (fd, buf, len) != (ssize_t) len)
+            goto materialize_failed;
+        bytes -= len;
+    }
+    fsync (fd);
+    close (fd);
+
+    ESP_LOGW (TAG, "%s: %d KB%s, created in %d ms", path, hdr.data_bytes / 1024,
+        (hdr.state == RAWREC_STATE_RECORDING) ? " recovered after power loss" : "",
+        (uint32_t) ((esp_timer_get_time () - start) / 1000));
+
+    // Region is free for the next capture
+    hdr.state = RAWREC_STATE_EMPTY;
+    return rawrec_write_header ();
+
+    materialize_failed:
+    close (fd);
+    ESP_LOGE (TAG, "Failed to create %s, capture stays in the raw region", path);
+    return ESP_FAIL;
+}
@@ -0,0 +1,50 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _RAWREC_H_
+#define _RAWREC_H_
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "sdmmc_cmd.h"
+
+// The raw region is the unpartitioned space after the last partition of the card.
+// Leave at least RAWREC_MIN_MB unallocated at the end of the card to use it.
+#define RAWREC_MIN_MB               64
+// Only this much of it is used, so the byte counts fit 32 bits and the
+// materialized file fits FAT32 (about 6 h 12 min of 48 kHz 16-bit stereo)
+#define RAWREC_MAX_MB               4095
+// Journal the committed data length every N blocks, at most this much is lost on power failure
+#define RAWREC_COMMIT_BLOCKS        64
+// Two alternating header copies at the start of the region, samples follow
+#define RAWREC_HEADER_SECTORS       2
+#define RAWREC_SECTOR_SIZE          512
+
+esp_err_t rawrec_init (sdmmc_card_t *card);
+esp_err_t rawrec_start (uint32_t sample_rate, uint16_t channels, uint16_t bits);
+esp_err_t rawrec_write (const void *data, size_t len);
+esp_err_t rawrec_stop (void);
+esp_err_t rawrec_materialize (void *buf, size_t len);
+
+#endif
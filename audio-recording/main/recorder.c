@@ -36,9 +36,42 @@ software.
 #include "audiosom32_driver.h"
 #include "audiosom32_carrier.h"
 #include "recorder.h"
+#include "profiler.h"
+#include "audio_pm.h"
+#include "audio_mem.h"
+#include "writer.h"
+#include "rawrec.h"
+#include "monitor.h"
+#include "latency.h"
+#include "overdub.h"
+#include "volume.h"
+#include "meter.h"
+#include "vad.h"
+#include "agc.h"
+#include "dcblock.h"
+#include "decim.h"
 
 static const char *TAG = "recorder.c";
 static bool button_pressed = false;
+static audio_block_pool_t rec_blocks;
+static dcblock_t rec_dcblock;
+static audio_block_pool_t rec_voice_blocks;
+static decim_t rec_decim;
+static bool rec_voice_on = false;
+static int16_t *rec_voice_block = NULL;
+static size_t rec_voice_fill;
+static uint32_t rec_voice_drops;
+static bool rec_voice_failed;
+static bool rec_write_failed;
+static audiosom32_capture_t rec_capture =
+{
+    .source = REC_INPUT,
+    .mic_gain = REC_MIC_GAIN,
+    .mic_bias = REC_MIC_BIAS,
+    .mic_bias_mv = REC_MIC_BIAS_MV,
+    .adc_db = 0,
+    .monitor = 1
+};
 
 // Executed every time any button is pressed
 void IRAM_ATTR as32_btn_isr_handler(void* arg)
@@ -50,37 +83,182 @@ void IRAM_ATTR as32_btn_isr_handler(void* arg)
     // ets_printf ("#");
 }
 
-void audio_rec_task (void *pvParameter)
+/*
+    Mono from interleaved stereo in place, REC_CHANNELS selects which.
+    Returns the new length in bytes.
+*/
+static size_t rec_downmix (int16_t *samples, size_t frames)
+{
+    size_t i;
+
+    if (REC_CHANNELS == REC_CHANNELS_LEFT)
+        for (i = 0; i < frames; i++)
+            samples[i] = samples[2*i];
+    else if (REC_CHANNELS == REC_CHANNELS_RIGHT)
+        for (i = 0; i < frames; i++)
+            samples[i] = samples[2*i + 1];
+    else
+        for (i = 0; i < frames; i++)
+            samples[i] = (samples[2*i] + samples[2*i + 1]) >> 1;
+
+    return frames * sizeof (int16_t);
+}
+
+/*
+    Voice track: decimated samples gathered into voice blocks that go to
+    the writer as they fill up
+*/
+static void rec_voice_put (const int16_t *out, size_t n)
+{
+    size_t i, chunk;
+
+    for (i = 0; i < n; i += chunk)
+    {
+        if (rec_voice_block == NULL)
+        {
+            // A gap in the voice track rather than a stall of the capture
+            rec_voice_block = audio_block_get (&rec_voice_blocks, 0);
+            if (rec_voice_block == NULL)
+            {
+                rec_voice_drops += n - i;
+                return;
+            }
+            rec_voice_fill = 0;
+        }
+
+        chunk = REC_VOICE_BLOCK_SIZE / 2 - rec_voice_fill;
+        if (chunk > n - i)
+            chunk = n - i;
+        memcpy (&rec_voice_block[rec_voice_fill], &out[i], chunk * sizeof (int16_t));
+        rec_voice_fill += chunk;
+
+        if (rec_voice_fill == REC_VOICE_BLOCK_SIZE / 2)
+        {
+            // The voice track is the lesser file, the recording goes on without it
+            if (writer_submit (REC_STREAM_VOICE, &rec_voice_blocks, rec_voice_block, REC_VOICE_BLOCK_SIZE) == ESP_ERR_INVALID_STATE &&
+                !rec_voice_failed)
+            {
+                ESP_LOGE (TAG, "Writing %s failed, recording without it", REC_VOICE_FILE);
+                rec_voice_failed = true;
+            }
+            rec_voice_block = NULL;
+        }
+    }
+}
+
+/*
+    Voice track: a block of mono or stereo down to 16 kHz mono. A mono
+    recording block has more frames than decim_process () takes at once.
+*/
+static void rec_voice (const int16_t *samples, size_t frames, int channels)
 {
-    FILE *f;
-    size_t written;
-    short *samples;
+    static int16_t out[DECIM_MAX_OUT];
+    size_t part;
+
+    for (; frames > 0; frames -= part, samples += part * channels)
+    {
+        part = (frames < DECIM_MAX_FRAMES) ? frames : DECIM_MAX_FRAMES;
+        rec_voice_put (out, decim_process (&rec_decim, samples, part, channels, out));
+    }
+}
 
-    // Fill WAV file header with necessary values. File size is left to 0.
-    // Most players like Audacity and VLC will ignore wave data size descriptor anyway
-    wav_header wav_hdr = 
+/*
+    A block of len bytes for REC.WAV, and the voice track made from it.
+    The VAD gate writes through here too, so VOICE.WAV has the same regions
+    as REC.WAV and the times in the sidecar hold for both.
+*/
+static void rec_write (void *block, size_t len)
+{
+    if (rec_voice_on)
     {
-        .riff_header = "RIFF",
-        .wav_size = 0,
-        .wave_header = "WAVE",
-
-        .fmt_header = "fmt ",
-        .fmt_chunk_size = 16,
-        .audio_format = 1,
-        .num_channels = 2,
-        .sample_rate = 48000,
-        .byte_rate = 48000*2*2,
-        .sample_alignment = 4,
-        .bit_depth = 16, 
-
-        .data_header = "data"
-    };
-
-    // Allocate buffer for recording data into and then dumping into SD card
-    samples = malloc (2048);
-    if (samples == NULL)
+        if (REC_CHANNELS == REC_CHANNELS_STEREO)
+            rec_voice (block, len/4, 2);
+        else
+            rec_voice (block, len/2, 1);
+    }
+
+    // Recording is stopped once nothing more reaches the card
+    if (writer_submit (REC_STREAM_MAIN, &rec_blocks, block, len) == ESP_ERR_INVALID_STATE)
+        rec_write_failed = true;
+}
+
+/*
+    Processing of a captured block of len bytes of stereo, then to the
+    SD card writer, through the VAD gate if gate is set
+*/
+static void rec_submit (void *block, size_t len, bool gate)
+{
+    // DC removed first so it does not count as level for the AGC
+    if (REC_DCBLOCK)
+        dcblock_process (block, len/4, &rec_dcblock);
+    if (REC_AGC)
+        agc_process (block, len/4, NULL);
+
+    // Mono blocks are written half full
+    if (REC_CHANNELS != REC_CHANNELS_STEREO)
+        len = rec_downmix (block, len/4);
+
+    if (gate)
+        vad_gate_submit (block, len);
+    else
+        rec_write (block, len);
+}
+
+/*
+    Record from another input, also while recording. With the AGC running
+    its task does the switch and keeps the gain it has reached, otherwise the
+    capture registers are rewritten from rec_capture.
+*/
+esp_err_t rec_set_input (audiosom32_input_t source)
+{
+    rec_capture.source = source;
+    if (!(REC_AGC && agc_set_input (source) == ESP_OK) &&
+        audiosom32_set_capture (&rec_capture) != ESP_OK)
+        return ESP_FAIL;
+
+    ESP_LOGI (TAG, "Recording from %s", source == AUDIOSOM32_INPUT_MIC ? "mic" : "line in");
+    return ESP_OK;
+}
+
+void audio_rec_task (void *pvParameter)
+{
+    size_t read;
+    void *block;
+    uint32_t overruns, start_frame;
+    bool overdub, gate;
+    bool raw = false;
+    float hp_db;
+    esp_err_t ret;
+    static wav_header wav_hdr, voice_hdr;
+
+    // Fill WAV file header with necessary values. Sizes are filled in by the writer.
+    wav_init_header (&wav_hdr, AUDIOSOM32_SAMPLERATE, REC_CHANNELS == REC_CHANNELS_STEREO ? 2 : 1, AUDIOSOM32_BITSPERSAMPLE);
+    wav_init_header (&voice_hdr, REC_VOICE_RATE, 1, AUDIOSOM32_BITSPERSAMPLE);
+
+    // Blocks for recording data into, passed by pointer to the SD card writer
+    if (audio_block_pool_init (&rec_blocks, AUDIO_POOL_CAPTURE, REC_BLOCK_SIZE, REC_POOL_BLOCKS) != ESP_OK)
+        goto end_recording;
+    if (REC_VOICE && audio_block_pool_init (&rec_voice_blocks, AUDIO_POOL_RING, REC_VOICE_BLOCK_SIZE, REC_VOICE_BLOCK_COUNT) != ESP_OK)
+        goto end_recording;
+    audio_mem_report ();
+
+    if (writer_init () != ESP_OK)
         goto end_recording;
 
+    // Raw region, turn a capture left over from before the reset into a WAV file
+    if (REC_STORAGE == REC_STORAGE_RAW)
+    {
+        if (rawrec_init (audiosom32_sd_card ()) == ESP_OK)
+        {
+            raw = true;
+            block = audio_block_get (&rec_blocks, portMAX_DELAY);
+            rawrec_materialize (block, REC_BLOCK_SIZE);
+            audio_block_put (&rec_blocks, block);
+        }
+        else
+            ESP_LOGW (TAG, "No raw region on this card, recording to REC.WAV instead");
+    }
+
     // Set up default recording mode:
     // Line in -> ADC -> I2S out
     // Line in -> HP
@@ -89,6 +267,57 @@ void audio_rec_task (void *pvParameter)
     else
         ESP_LOGI (TAG, "Seems like AudioSOM32 is not connected configured!\n");
 
+    // Input, gain and bias on top of the default line in routing
+    if (audiosom32_set_capture (&rec_capture) != ESP_OK)
+        ESP_LOGE (TAG, "Failed to set up the capture input!");
+
+    // Round trip latency of the I2S in -> I2S out loop, needs a loopback cable
+    if (LATENCY_TEST_AT_BOOT)
+    {
+        audiosom32_route_monitor (1);
+        if (latency_run () != ESP_OK)
+            ESP_LOGE (TAG, "Latency measurement failed!");
+        if (!MONITOR_ENABLE)
+            audiosom32_route_monitor (0);
+    }
+
+    // Line in -> ADC -> I2S in -> monitor task -> I2S out -> DAC -> HP instead,
+    // with low latency I2S buffering
+    if (MONITOR_ENABLE && monitor_init () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to set up monitoring!");
+
+    // Input levels, on the carrier LED too. With monitoring on the meter is
+    // the first stage so it sees the input whether recording or not, added
+    // before the monitor task starts running the stages
+    if (meter_init () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to start level meter!");
+    else if (MONITOR_ENABLE && monitor_add_stage (meter_process, NULL) != ESP_OK)
+        ESP_LOGE (TAG, "Failed to add level meter to the monitor!");
+
+    if (MONITOR_ENABLE && monitor_start () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to start monitoring!");
+    if (MONITOR_ENABLE && overdub_init () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to set up overdubbing!");
+
+    if (REC_DCBLOCK && dcblock_init (&rec_dcblock, DCBLOCK_TYPE, DCBLOCK_CORNER_HZ, AUDIOSOM32_SAMPLERATE) != ESP_OK)
+        ESP_LOGE (TAG, "Failed to set up DC blocker!");
+    if (REC_VOICE && decim_init (&rec_decim, AUDIOSOM32_SAMPLERATE) != ESP_OK)
+        ESP_LOGE (TAG, "Failed to set up the voice track decimator!");
+
+    // With line in the AGC only moves the ADC volume, with the mic also the preamp
+    if (REC_AGC && agc_start (&rec_capture) != ESP_OK)
+        ESP_LOGE (TAG, "Failed to start AGC!");
+
+    // Fade the headphones in from the volume task, the audio tasks never wait on I2C
+    if (volume_init () != ESP_OK)
+        ESP_LOGE (TAG, "Failed to start volume control!");
+    else
+    {
+        hp_db = volume_get (AUDIOSOM32_VOLUME_HP);
+        volume_set (AUDIOSOM32_VOLUME_HP, AUDIOSOM32_HP_VOL_MIN_DB);
+        volume_fade (AUDIOSOM32_VOLUME_HP, hp_db, REC_HP_FADE_IN_MS, VOLUME_CURVE_SMOOTH);
+    }
+
     while (1)
     {
         // Wait for button press event before recording to SD card
@@ -99,40 +328,140 @@ void audio_rec_task (void *pvParameter)
         button_pressed = false;
         ESP_LOGW (TAG, "Button pressed, started recording...");
 
-        // Write WAV into a file, overwrite existing one
-        f = fopen ("/sdcard/REC.WAV", "w");
-        if (f == NULL)
+        // Write WAV into a file with its header, overwrite existing one
+        if (raw)
+            ret = writer_open_raw (REC_STREAM_MAIN, wav_hdr.sample_rate, wav_hdr.num_channels, wav_hdr.bit_depth);
+        else
+            ret = writer_open (REC_STREAM_MAIN, "/sdcard/REC.WAV", &wav_hdr);
+        if (ret != ESP_OK)
         {
-            ESP_LOGE (TAG, "Failed to create REC.WAV...");
+            ESP_LOGE (TAG, "Failed to create %s...", raw ? "raw capture" : "REC.WAV");
             break;
         }
 
-        // Write WAV header into file before recording
-        written = fwrite (&wav_hdr, 1, sizeof (wav_hdr), f);
+        // The voice track goes alongside through the same writer, the raw
+        // region only takes one stream
+        rec_voice_on = false;
+        if (REC_VOICE && !raw)
+        {
+            decim_reset (&rec_decim);
+            rec_voice_drops = 0;
+            rec_voice_failed = false;
+            rec_voice_on = writer_open (REC_STREAM_VOICE, REC_VOICE_FILE, &voice_hdr) == ESP_OK;
+            if (!rec_voice_on)
+                ESP_LOGE (TAG, "Failed to create %s, recording without it", REC_VOICE_FILE);
+        }
+
+        // With a backing track on the card it plays along, and the recording
+        // starts at its first sample plus the round trip latency
+        overruns = 0;
+        rec_write_failed = false;
+        overdub = MONITOR_ENABLE && overdub_start (REC_OVERDUB_FILE, &start_frame) == ESP_OK;
+        if (MONITOR_ENABLE)
+            monitor_capture_start (&rec_blocks, overdub ? start_frame + overdub_latency () : monitor_frames ());
 
+        // Silence is not written, unless the recording has to stay sample aligned
+        gate = REC_VAD && !raw && !overdub &&
+               vad_gate_start (&rec_blocks, rec_write, REC_BLOCK_SIZE * wav_hdr.num_channels / 2,
+                               wav_hdr.sample_rate, wav_hdr.num_channels) == ESP_OK;
         while (1)
-        {            
-            // Wait for 2048 samples to arrive
-            gpio_set_level(AS32_LED_GPIO, 0);       // LED on
-            i2s_read (AUDIOSOM32_I2S_NUM, samples, 2048, &written, portMAX_DELAY);
-            gpio_set_level(AS32_LED_GPIO, 1);       // LED off
-            // Dump it into the file
-            written = fwrite (samples, 1, 2048, f);
-
-            // Stop recording?
-            if (button_pressed == true)
+        {
+            if (MONITOR_ENABLE)
+            {
+                // The monitor task owns I2S in and fills blocks from rec_blocks
+                block = monitor_capture_get (portMAX_DELAY);
+                read = REC_BLOCK_SIZE;
+            }
+            else
+            {
+                block = audio_block_get (&rec_blocks, 0);
+                if (block == NULL)
+                {
+                    // SD card fell behind and every block is waiting to be written
+                    overruns++;
+                    block = audio_block_get (&rec_blocks, portMAX_DELAY);
+                }
+
+                // Wait for REC_BLOCK_SIZE bytes of samples to arrive
+#if !METER_LED
+                gpio_set_level(AS32_LED_GPIO, 0);       // LED on
+#endif
+                i2s_read (AUDIOSOM32_I2S_NUM, block, REC_BLOCK_SIZE, &read, portMAX_DELAY);
+#if !METER_LED
+                gpio_set_level(AS32_LED_GPIO, 1);       // LED off
+#endif
+                meter_process (block, read/(METER_CHANNELS*2), NULL);
+            }
+            // Hand it over to the SD card writer
+            rec_submit (block, read, gate);
+
+            // Stop recording? Overdubs also stop at the end of the backing track
+            if (button_pressed == true || (overdub && !overdub_active ()))
+                break;
+            if (rec_write_failed)
+            {
+                ESP_LOGE (TAG, "Writing %s failed, recording stopped!", raw ? "raw capture" : "REC.WAV");
                 break;
+            }
+        }
+
+        // Blocks the monitor filled before capture stopped still belong to the recording
+        if (MONITOR_ENABLE)
+        {
+            overruns += monitor_capture_stop ();
+            while ((block = monitor_capture_get (0)) != NULL)
+                rec_submit (block, REC_BLOCK_SIZE, gate);
         }
+        if (overdub)
+            overdub_stop ();
 
         // Debounce
         vTaskDelay (500/portTICK_RATE_MS);
         button_pressed = false;
 
-        // Save recording
-        fclose (f);
-        ESP_LOGW (TAG, "Saved REC.WAV!");
+        // Save recording once the writer has caught up
+        if (writer_close (REC_STREAM_MAIN) != ESP_OK)
+            ESP_LOGE (TAG, "%s is incomplete!", raw ? "Raw capture" : "REC.WAV");
+        ESP_LOGW (TAG, "Saved %s!", raw ? "raw capture" : "REC.WAV");
+        writer_report (REC_STREAM_MAIN);
+        if (gate && vad_gate_stop (REC_VAD_SIDECAR) != ESP_OK)
+            ESP_LOGE (TAG, "Failed to save the list of active regions!");
+
+        // Voice track with its last, partly filled block
+        if (rec_voice_on)
+        {
+            rec_voice_on = false;
+            if (rec_voice_block != NULL)
+                writer_submit (REC_STREAM_VOICE, &rec_voice_blocks, rec_voice_block, rec_voice_fill * sizeof (int16_t));
+            rec_voice_block = NULL;
+            if (writer_close (REC_STREAM_VOICE) != ESP_OK)
+                ESP_LOGE (TAG, "%s is incomplete!", REC_VOICE_FILE);
+            ESP_LOGW (TAG, "Saved %s!", REC_VOICE_FILE);
+            writer_report (REC_STREAM_VOICE);
+            if (rec_voice_drops)
+                ESP_LOGW (TAG, "Voice track: %d samples dropped, at least %d of %d blocks always free",
+                    rec_voice_drops, rec_voice_blocks.min_free, rec_voice_blocks.count);
+        }
+
+        // Raw capture becomes a WAV file now, before the region is reused
+        if (raw)
+        {
+            block = audio_block_get (&rec_blocks, portMAX_DELAY);
+            if (rawrec_materialize (block, REC_BLOCK_SIZE) != ESP_OK)
+                raw = false;
+            audio_block_put (&rec_blocks, block);
+        }
+        ESP_LOGI (TAG, "Capture: %d overruns, at least %d of %d blocks always free",
+            overruns, rec_blocks.min_free, rec_blocks.count);
+        if (MONITOR_ENABLE)
+            monitor_report ();
+        meter_report ();
+        if (REC_AGC)
+            agc_report ();
+        // Load and stack usage of the finished recording
+        profiler_dump ();
+        audio_pm_report ();
     }
-    free (samples);
 
     end_recording:
     ESP_LOGW (TAG, "IDLE, only reaches here on error!");
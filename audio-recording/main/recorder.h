@@ -25,27 +25,67 @@ software.
 #ifndef _RECORDER_H_
 #define _RECORDER_H_
 
-typedef __attribute__((packed)) struct wav_header
-{
-    // RIFF Header
-    uint8_t riff_header[4]; // Contains "RIFF"
-    uint32_t wav_size; // Size of the wav portion of the file, which follows the first 8 bytes. File size - 8
-    uint8_t wave_header[4]; // Contains "WAVE"
-    
-    // Format Header
-    uint8_t fmt_header[4]; // Contains "fmt " (includes trailing space)
-    uint32_t fmt_chunk_size; // Should be 16 for PCM
-    uint16_t audio_format; // Should be 1 for PCM. 3 for IEEE Float
-    uint16_t num_channels;
-    uint32_t sample_rate;
-    uint32_t byte_rate; // Number of bytes per second. sample_rate * num_channels * Bytes Per Sample
-    uint16_t sample_alignment; // num_channels * Bytes Per Sample
-    uint16_t bit_depth; // Number of bits per sample
-    
-    // Data
-    uint8_t data_header[4]; // Contains "data"
-} wav_header;
+#include "wav.h"
+#include "audiosom32_driver.h"
+#include "decim.h"
+// Block sizes and counts, REC_VAD and REC_VOICE
+#include "audio_mem_config.h"
 
+// Writer streams used for the recording and the voice track
+#define REC_STREAM_MAIN     0
+#define REC_STREAM_VOICE    1
+
+// Where recordings go:
+// REC_STORAGE_FAT: straight into REC.WAV
+// REC_STORAGE_RAW: raw sectors after the last partition, copied to RAWnnnnn.WAV after stop
+#define REC_STORAGE_FAT     0
+#define REC_STORAGE_RAW     1
+#define REC_STORAGE         REC_STORAGE_FAT
+
+// Channels written to the file:
+// REC_CHANNELS_STEREO: both, as captured
+// REC_CHANNELS_LEFT, REC_CHANNELS_RIGHT: mono from one channel (e.g. a mono mic on one side)
+// REC_CHANNELS_MID: mono (L+R)/2
+// Mono halves the SD write bandwidth and the file size
+#define REC_CHANNELS_STEREO 0
+#define REC_CHANNELS_LEFT   1
+#define REC_CHANNELS_RIGHT  2
+#define REC_CHANNELS_MID    3
+#define REC_CHANNELS        REC_CHANNELS_STEREO
+
+// Played along while recording if it exists (needs MONITOR_ENABLE), the
+// recording is aligned sample by sample to it. 48 kHz 16-bit stereo PCM
+#define REC_OVERDUB_FILE    "/sdcard/BACKING.WAV"
+
+// Input recorded, AUDIOSOM32_INPUT_LINE_IN or AUDIOSOM32_INPUT_MIC. rec_set_input ()
+// switches it while running
+#define REC_INPUT           AUDIOSOM32_INPUT_LINE_IN
+// Mic settings (see audiosom32_capture_t)
+#define REC_MIC_GAIN        1           // +20 dB
+#define REC_MIC_BIAS        1           // 2K bias resistor
+#define REC_MIC_BIAS_MV     1500
+
+// Remove DC offset from the recorded blocks (see dcblock.h). The codec's own
+// ADC high-pass is already on, this is for inputs that still carry DC
+// (e.g. with ADC_HPF_BYPASS set) and ahead of compressed formats
+#define REC_DCBLOCK         0
+
+// Automatic gain control of the input (see agc.h): analog gain in the codec,
+// digital fine gain on the recorded blocks.
+// Off by default, it changes the level of music captured at a set gain
+#define REC_AGC             0
+
+// Regions REC_VAD (audio_mem_config.h) wrote, with their times
+#define REC_VAD_SIDECAR     "/sdcard/REC.TXT"
+
+// Voice track written with REC_VOICE (audio_mem_config.h)
+#define REC_VOICE_FILE      "/sdcard/VOICE.WAV"
+#define REC_VOICE_RATE      (AUDIOSOM32_SAMPLERATE / DECIM_FACTOR)
+
+// Headphones fade in over this long once monitoring starts
+#define REC_HP_FADE_IN_MS   500
+
+esp_err_t rec_set_input (audiosom32_input_t source);
 void audio_rec_task (void *pvParameter);
 
 #endif
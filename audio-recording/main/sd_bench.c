@@ -0,0 +1,292 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "audiosom32_driver.h"
+#include "audiosom32_carrier.h"
+#include "recorder.h"
+#include "audio_mem.h"
+#include "monitor.h"
+#include "audio_pm.h"
+#include "sd_bench.h"
+
+static const char *TAG = "sd_bench.c";
+
+// Latency histogram: 100 us steps up to 10 ms, then 10 ms steps up to 500 ms, then overflow
+#define HIST_FINE_BUCKETS           100
+#define HIST_FINE_US                100
+#define HIST_COARSE_BUCKETS         49
+#define HIST_COARSE_US              10000
+#define HIST_BUCKETS                (HIST_FINE_BUCKETS + HIST_COARSE_BUCKETS + 1)
+
+typedef struct
+{
+    const char *name;
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t bytes_per_sample;      // As stored in the file
+} sd_bench_format_t;
+
+static const sd_bench_format_t formats[] =
+{
+    { "48k/16/mono",    48000, 1, 2 },
+    { "48k/16/stereo",  48000, 2, 2 },
+    { "48k/24/stereo",  48000, 2, 4 },
+    { "96k/16/stereo",  96000, 2, 2 },
+    { "96k/24/stereo",  96000, 2, 4 },
+};
+
+static const uint32_t block_sizes[] = { 512, 2048, 8192, 16384 };
+
+// The write buffer is borrowed from the capture pool before recording starts
+_Static_assert (AUDIO_MEM_CAPTURE_SIZE >= 16384, "Capture pool smaller than the largest benchmark block");
+
+#define NUM_FORMATS                 (sizeof (formats) / sizeof (formats[0]))
+#define NUM_BLOCK_SIZES             (sizeof (block_sizes) / sizeof (block_sizes[0]))
+
+static uint32_t hist[HIST_BUCKETS];
+static uint32_t seq_kbps[NUM_BLOCK_SIZES];
+
+static void hist_add (uint32_t us)
+{
+    if (us < HIST_FINE_BUCKETS * HIST_FINE_US)
+        hist[us / HIST_FINE_US]++;
+    else if (us < HIST_FINE_BUCKETS * HIST_FINE_US + HIST_COARSE_BUCKETS * HIST_COARSE_US)
+        hist[HIST_FINE_BUCKETS + (us - HIST_FINE_BUCKETS * HIST_FINE_US) / HIST_COARSE_US]++;
+    else
+        hist[HIST_BUCKETS - 1]++;
+}
+
+/*
+    Upper edge (in us) of the bucket holding the given percentile
+*/
+static uint32_t hist_percentile (uint32_t total, uint32_t percent, uint32_t max_us)
+{
+    uint32_t i, count = 0, target;
+
+    target = (total * percent + 99) / 100;
+    for (i = 0; i < HIST_BUCKETS - 1; i++)
+    {
+        count += hist[i];
+        if (count >= target)
+        {
+            if (i < HIST_FINE_BUCKETS)
+                return (i + 1) * HIST_FINE_US;
+            return HIST_FINE_BUCKETS * HIST_FINE_US + (i - HIST_FINE_BUCKETS + 1) * HIST_COARSE_US;
+        }
+    }
+
+    return max_us;
+}
+
+/*
+    Write bytes in len-sized writes to a fresh file, fsync included.
+    If lat_max is not NULL every write () is timed into the histogram.
+    Returns throughput in KB/s, 0 on error.
+*/
+static uint32_t sd_bench_write (const uint8_t *buf, uint32_t len, uint32_t bytes, uint32_t *lat_max)
+{
+    int fd;
+    uint32_t done, elapsed;
+    int64_t start, t;
+
+    fd = open (SD_BENCH_FILE, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0)
+        return 0;
+
+    start = esp_timer_get_time ();
+    for (done = 0; done < bytes; done += len)
+    {
+        t = esp_timer_get_time ();
+        if (write (fd, buf, len) != (ssize_t) len)
+        {
+            close (fd);
+            return 0;
+        }
+
+        if (lat_max != NULL)
+        {
+            elapsed = (uint32_t) (esp_timer_get_time () - t);
+            hist_add (elapsed);
+            if (elapsed > *lat_max)
+                *lat_max = elapsed;
+        }
+    }
+    fsync (fd);
+    elapsed = (uint32_t) (esp_timer_get_time () - start);
+    close (fd);
+
+    if (elapsed == 0)
+        return 0;
+
+    return (uint32_t) ((uint64_t) bytes * 1000000 / elapsed / 1024);
+}
+
+/*
+    A format is sustainable if the card keeps up with its data rate (plus the
+    voice track) and margin, and the slowest write seen fits into the capture
+    buffering: the capture blocks not taken by the one being filled (the VAD
+    pre-roll has its own) plus the I2S DMA ring in use, and the voice blocks
+*/
+static bool sd_bench_verdict (const sd_bench_format_t *fmt, uint32_t kbps, uint32_t lat_max, uint32_t *buffer_ms)
+{
+    uint32_t rate = fmt->sample_rate * fmt->channels * fmt->bytes_per_sample;
+    uint32_t ring_frames, voice_ms;
+
+    if (MONITOR_ENABLE)
+        ring_frames = MONITOR_DMA_BUF_COUNT * MONITOR_BLOCK_FRAMES;
+    else
+        ring_frames = AUDIOSOM32_DMA_BUF_COUNT * AUDIOSOM32_DMA_BUF_LEN;
+
+    *buffer_ms = (uint32_t) ((uint64_t) (REC_BLOCK_COUNT - 1) * REC_BLOCK_SIZE * 1000 / rate)
+        + ring_frames * 1000 / fmt->sample_rate;
+
+    // The voice track stops (drops samples) once its own blocks run out
+    if (REC_VOICE)
+    {
+        voice_ms = (REC_VOICE_BLOCK_COUNT - 1) * REC_VOICE_BLOCK_SIZE * 1000 / (REC_VOICE_RATE * sizeof (int16_t));
+        if (voice_ms < *buffer_ms)
+            *buffer_ms = voice_ms;
+        rate += REC_VOICE_RATE * sizeof (int16_t);
+    }
+
+    if ((uint64_t) kbps * 1024 * 100 < (uint64_t) rate * SD_BENCH_MARGIN_PERCENT)
+        return false;
+    if (lat_max / 1000 >= *buffer_ms)
+        return false;
+
+    return true;
+}
+
+/*
+    Qualify the mounted card for recording:
+    - sequential write throughput for several block sizes
+    - write () latency histogram over a sustained run of REC_BLOCK_SIZE blocks
+    - pass/fail per recording format for the configured buffer depth
+    Logs the verdict and writes the full report to SD_BENCH_REPORT.
+    Uses the capture pool as scratch, so run it before recording starts.
+*/
+esp_err_t sd_bench_run (void)
+{
+    uint8_t *buf;
+    uint32_t i, total = 0, lat_max = 0, sustained, buffer_ms;
+    uint32_t p50, p99;
+    bool ok;
+    FILE *f;
+
+    buf = audio_mem_alloc (AUDIO_POOL_CAPTURE, block_sizes[NUM_BLOCK_SIZES - 1]);
+    if (buf == NULL)
+        return ESP_ERR_NO_MEM;
+    for (i = 0; i < block_sizes[NUM_BLOCK_SIZES - 1]; i++)
+        buf[i] = i;
+
+    ESP_LOGI (TAG, "Benchmarking SD card, this takes a few seconds...");
+    audio_pm_work_begin ();
+
+    for (i = 0; i < NUM_BLOCK_SIZES; i++)
+        seq_kbps[i] = sd_bench_write (buf, block_sizes[i], SD_BENCH_SEQ_BYTES, NULL);
+
+    memset (hist, 0, sizeof (hist));
+    sustained = sd_bench_write (buf, REC_BLOCK_SIZE, SD_BENCH_SUSTAINED_BYTES, &lat_max);
+
+    audio_pm_work_end ();
+    unlink (SD_BENCH_FILE);
+    audio_mem_reset (AUDIO_POOL_CAPTURE);
+
+    if (sustained == 0)
+    {
+        ESP_LOGE (TAG, "Benchmark writes failed, card is not usable for recording!");
+        return ESP_FAIL;
+    }
+
+    for (i = 0; i < HIST_BUCKETS; i++)
+        total += hist[i];
+    p50 = hist_percentile (total, 50, lat_max);
+    p99 = hist_percentile (total, 99, lat_max);
+
+    ESP_LOGI (TAG, "Sustained %d KB/s, write latency p50 %d us, p99 %d us, max %d us",
+        sustained, p50, p99, lat_max);
+    for (i = 0; i < NUM_FORMATS; i++)
+    {
+        ok = sd_bench_verdict (&formats[i], sustained, lat_max, &buffer_ms);
+        if (ok)
+            ESP_LOGI (TAG, "%-14s OK", formats[i].name);
+        else
+            ESP_LOGW (TAG, "%-14s TOO SLOW (needs %d KB/s, %d ms buffered)", formats[i].name,
+                formats[i].sample_rate * formats[i].channels * formats[i].bytes_per_sample / 1024, buffer_ms);
+    }
+
+    // Full report for later reference
+    f = fopen (SD_BENCH_REPORT, "w");
+    if (f == NULL)
+    {
+        ESP_LOGE (TAG, "Failed to create %s", SD_BENCH_REPORT);
+        return ESP_FAIL;
+    }
+
+    fprintf (f, "SD bus mode: %s\n\n", audiosom32_sd_mode ());
+    fprintf (f, "Sequential write, %d KB per block size\n", SD_BENCH_SEQ_BYTES / 1024);
+    for (i = 0; i < NUM_BLOCK_SIZES; i++)
+        fprintf (f, "  %6d bytes: %6d KB/s\n", block_sizes[i], seq_kbps[i]);
+
+    fprintf (f, "\nSustained write, %d KB in %d byte blocks: %d KB/s\n",
+        SD_BENCH_SUSTAINED_BYTES / 1024, REC_BLOCK_SIZE, sustained);
+    fprintf (f, "  latency p50 %d us, p99 %d us, max %d us\n", p50, p99, lat_max);
+    fprintf (f, "  histogram (upper edge us: count)\n");
+    for (i = 0; i < HIST_BUCKETS - 1; i++)
+    {
+        if (hist[i] == 0)
+            continue;
+        if (i < HIST_FINE_BUCKETS)
+            fprintf (f, "  %6d: %d\n", (i + 1) * HIST_FINE_US, hist[i]);
+        else
+            fprintf (f, "  %6d: %d\n", HIST_FINE_BUCKETS * HIST_FINE_US + (i - HIST_FINE_BUCKETS + 1) * HIST_COARSE_US, hist[i]);
+    }
+    if (hist[HIST_BUCKETS - 1] > 0)
+        fprintf (f, "  longer: %d\n", hist[HIST_BUCKETS - 1]);
+
+    fprintf (f, "\nFormats (%d blocks of %d bytes, %d%% throughput margin)\n",
+        REC_BLOCK_COUNT, REC_BLOCK_SIZE, SD_BENCH_MARGIN_PERCENT);
+    for (i = 0; i < NUM_FORMATS; i++)
+    {
+        ok = sd_bench_verdict (&formats[i], sustained, lat_max, &buffer_ms);
+        fprintf (f, "  %-14s %6d KB/s, %4d ms buffered: %s\n", formats[i].name,
+            formats[i].sample_rate * formats[i].channels * formats[i].bytes_per_sample / 1024,
+            buffer_ms, ok ? "OK" : "TOO SLOW");
+    }
+    fclose (f);
+
+    return ESP_OK;
+}
@@ -0,0 +1,44 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _SD_BENCH_H_
+#define _SD_BENCH_H_
+
+#include "esp_err.h"
+
+// Run the benchmark every time the card is mounted (1) or never (0)
+#define SD_BENCH_AT_MOUNT           1
+// Data written per block size in the throughput test
+#define SD_BENCH_SEQ_BYTES          (1024*1024)
+// Data written in REC_BLOCK_SIZE blocks for the latency histogram
+#define SD_BENCH_SUSTAINED_BYTES    (4*1024*1024)
+// Required throughput headroom over the format's data rate, in percent
+#define SD_BENCH_MARGIN_PERCENT     150
+
+#define SD_BENCH_FILE               "/sdcard/BENCH.TMP"
+#define SD_BENCH_REPORT             "/sdcard/BENCH.TXT"
+
+esp_err_t sd_bench_run (void);
+
+#endif
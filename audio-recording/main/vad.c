@@ -0,0 +1,271 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "vad.h"
+
+static const char *TAG = "vad.c";
+
+typedef struct
+{
+    uint32_t start;                 // Frame in the recording, silence included
+    uint32_t offset;                // Frame in the written file
+    uint32_t frames;
+} vad_segment_t;
+
+static vad_t gate_vad;
+static audio_block_pool_t *gate_pool = NULL;
+static vad_write_t gate_write = NULL;
+static uint32_t gate_rate = 0;
+static int gate_channels = 2;
+static size_t gate_frame_bytes = 4;                 // 16-bit samples times gate_channels
+static void *preroll[VAD_PREROLL_BLOCKS];
+static int preroll_count = 0;
+static size_t preroll_len[VAD_PREROLL_BLOCKS];
+static bool in_segment = false;
+static uint32_t frames_seen = 0;
+static uint32_t frames_written = 0;
+static vad_segment_t segments[VAD_MAX_SEGMENTS];
+static int segment_count = 0;
+
+static float vad_level (float db)
+{
+    return powf (10, db / 10);
+}
+
+/*
+    Prepare a detector for blocks of block_frames frames
+*/
+void vad_init (vad_t *vad, size_t block_frames, uint32_t sample_rate)
+{
+    memset (vad, 0, sizeof (*vad));
+    vad->floor = -1;
+    vad->hang_blocks = (uint32_t) ((uint64_t) VAD_HANGOVER_MS * sample_rate / 1000 / block_frames) + 1;
+}
+
+/*
+    Energy and zero-crossing decision for one block of mono or interleaved
+    stereo, with hangover. Returns true while the block belongs to an active region.
+*/
+bool vad_block (vad_t *vad, const int16_t *samples, size_t frames, int channels)
+{
+    float energy, zcr, rate;
+    int64_t sum = 0;
+    int32_t mid, prev;
+    uint32_t crossings = 0;
+    bool raw;
+    size_t i;
+
+    if (frames == 0)
+        return vad->active;
+
+    // One pass over the mid (L+R) signal, or the only channel
+    if (channels == 2)
+    {
+        prev = (samples[0] + samples[1]) >> 1;
+        for (i = 0; i < frames; i++)
+        {
+            mid = (samples[2*i] + samples[2*i + 1]) >> 1;
+            sum += mid * mid;
+            crossings += (mid ^ prev) < 0;
+            prev = mid;
+        }
+    }
+    else
+    {
+        prev = samples[0];
+        for (i = 0; i < frames; i++)
+        {
+            mid = samples[i];
+            sum += mid * mid;
+            crossings += (mid ^ prev) < 0;
+            prev = mid;
+        }
+    }
+    energy = (float) sum / frames / (32768.0f * 32768.0f);
+    zcr = (float) crossings / frames;
+
+    // First block seeds the noise floor
+    if (vad->floor < 0)
+        vad->floor = fmaxf (energy, vad_level (VAD_MIN_LEVEL_DB));
+
+    raw = energy > vad_level (VAD_MIN_LEVEL_DB) &&
+          (energy > vad->floor * vad_level (VAD_THRESHOLD_DB) ||
+          (energy > vad->floor * vad_level (VAD_ZCR_THRESHOLD_DB) && zcr > VAD_ZCR_MIN));
+
+    // Floor drops at once to quieter blocks, rises slowly
+    rate = raw ? VAD_FLOOR_SLOW : VAD_FLOOR_FAST;
+    if (energy < vad->floor)
+        vad->floor = energy;
+    else
+        vad->floor += (energy - vad->floor) / rate;
+    vad->floor = fmaxf (vad->floor, vad_level (VAD_MIN_LEVEL_DB) / 4);
+
+    if (raw)
+        vad->hang = vad->hang_blocks;
+    else if (vad->hang > 0)
+        vad->hang--;
+    vad->active = raw || vad->hang > 0;
+
+    vad->blocks++;
+    if (vad->active)
+        vad->active_blocks++;
+
+    return vad->active;
+}
+
+static void vad_gate_write (void *block, size_t len)
+{
+    gate_write (block, len);
+    frames_written += len / gate_frame_bytes;
+    if (segment_count > 0)
+        segments[segment_count - 1].frames += len / gate_frame_bytes;
+}
+
+/*
+    Gate the blocks of a recording: only active regions (plus pre-roll and
+    hangover) are passed to write, in order, silent blocks go straight back
+    to pool. block_size is the length of the blocks that will be submitted,
+    channels 1 (mono) or 2 (interleaved stereo).
+*/
+esp_err_t vad_gate_start (audio_block_pool_t *pool, vad_write_t write, size_t block_size, uint32_t sample_rate, int channels)
+{
+    if (gate_pool != NULL)
+        return ESP_ERR_INVALID_STATE;
+    if (pool->count <= VAD_PREROLL_BLOCKS)
+        return ESP_ERR_INVALID_ARG;
+
+    gate_channels = channels;
+    gate_frame_bytes = channels * sizeof (int16_t);
+    vad_init (&gate_vad, block_size / gate_frame_bytes, sample_rate);
+    gate_pool = pool;
+    gate_write = write;
+    gate_rate = sample_rate;
+    preroll_count = 0;
+    in_segment = false;
+    frames_seen = 0;
+    frames_written = 0;
+    segment_count = 0;
+
+    return ESP_OK;
+}
+
+/*
+    Takes over a filled block, in place of the write function
+*/
+void vad_gate_submit (void *block, size_t len)
+{
+    int i;
+
+    if (vad_block (&gate_vad, block, len / gate_frame_bytes, gate_channels))
+    {
+        // Region starts with the held back blocks
+        if (!in_segment)
+        {
+            in_segment = true;
+            if (segment_count < VAD_MAX_SEGMENTS)
+            {
+                segments[segment_count].start = frames_seen;
+                for (i = 0; i < preroll_count; i++)
+                    segments[segment_count].start -= preroll_len[i] / gate_frame_bytes;
+                segments[segment_count].offset = frames_written;
+                segments[segment_count].frames = 0;
+                segment_count++;
+            }
+        }
+        for (i = 0; i < preroll_count; i++)
+            vad_gate_write (preroll[i], preroll_len[i]);
+        preroll_count = 0;
+        vad_gate_write (block, len);
+    }
+    else
+    {
+        in_segment = false;
+
+        // Keep as pre-roll, the oldest one goes back to the pool
+        if (preroll_count == VAD_PREROLL_BLOCKS)
+        {
+            audio_block_put (gate_pool, preroll[0]);
+            memmove (&preroll[0], &preroll[1], (VAD_PREROLL_BLOCKS - 1) * sizeof (preroll[0]));
+            memmove (&preroll_len[0], &preroll_len[1], (VAD_PREROLL_BLOCKS - 1) * sizeof (preroll_len[0]));
+            preroll_count--;
+        }
+        preroll[preroll_count] = block;
+        preroll_len[preroll_count] = len;
+        preroll_count++;
+    }
+
+    frames_seen += len / gate_frame_bytes;
+}
+
+/*
+    End gating, return held blocks and write the list of active regions to
+    sidecar_path (NULL for none): one line per region with its start in the
+    recording and in the written file, and its length, in seconds
+*/
+esp_err_t vad_gate_stop (const char *sidecar_path)
+{
+    FILE *f;
+    int i;
+
+    if (gate_pool == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    for (i = 0; i < preroll_count; i++)
+        audio_block_put (gate_pool, preroll[i]);
+    preroll_count = 0;
+    gate_pool = NULL;
+
+    ESP_LOGI (TAG, "%d active regions, %.1f%% of the recording written",
+        segment_count, frames_seen ? 100.0f * frames_written / frames_seen : 0.0f);
+
+    if (sidecar_path == NULL)
+        return ESP_OK;
+
+    f = fopen (sidecar_path, "w");
+    if (f == NULL)
+    {
+        ESP_LOGE (TAG, "Failed to create %s", sidecar_path);
+        return ESP_FAIL;
+    }
+    fprintf (f, "# region, start in recording (s), start in file (s), length (s)\n");
+    for (i = 0; i < segment_count; i++)
+        fprintf (f, "%d, %.3f, %.3f, %.3f\n", i + 1,
+            (float) segments[i].start / gate_rate,
+            (float) segments[i].offset / gate_rate,
+            (float) segments[i].frames / gate_rate);
+    fprintf (f, "# recorded %.3f s, written %.3f s\n",
+        (float) frames_seen / gate_rate, (float) frames_written / gate_rate);
+    fclose (f);
+
+    return ESP_OK;
+}
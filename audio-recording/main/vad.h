@@ -0,0 +1,76 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _VAD_H_
+#define _VAD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "audio_mem.h"
+#include "audio_mem_config.h"
+
+// A block is active if its energy is this far above the noise floor
+#define VAD_THRESHOLD_DB            9
+// Quieter blocks count as active if they cross zero this often (fricatives
+// like "s" and "f" have little energy but many zero crossings)
+#define VAD_ZCR_THRESHOLD_DB        4
+#define VAD_ZCR_MIN                 0.15f       // Zero crossings per sample
+// Absolute level below which a block is always silence, dBFS
+#define VAD_MIN_LEVEL_DB            -65
+// Noise floor follows silent blocks with this time constant, in blocks,
+// and creeps up during activity with the slower one (steady noise that starts
+// mid recording is not activity forever)
+#define VAD_FLOOR_FAST              16
+#define VAD_FLOOR_SLOW              1024
+// Activity continues this long after the last active block
+#define VAD_HANGOVER_MS             600
+// Pre-roll (VAD_PREROLL_BLOCKS) is in audio_mem_config.h, it sizes the capture pool
+// Active regions listed in the sidecar file, later ones are merged into the last
+#define VAD_MAX_SEGMENTS            256
+
+typedef struct
+{
+    float floor;                    // Noise floor, mean square of a silent block
+    uint32_t hang_blocks;           // Hangover length in blocks
+    uint32_t hang;                  // Hangover blocks left
+    bool active;
+    uint32_t blocks;                // Blocks seen
+    uint32_t active_blocks;         // Blocks judged active, including hangover
+} vad_t;
+
+// Detector, no IDF calls
+void vad_init (vad_t *vad, size_t block_frames, uint32_t sample_rate);
+bool vad_block (vad_t *vad, const int16_t *samples, size_t frames, int channels);
+
+// Takes over a block the gate lets through, and returns it to its pool when done
+typedef void (*vad_write_t) (void *block, size_t len);
+
+// Gate between the capture and the writer
+esp_err_t vad_gate_start (audio_block_pool_t *pool, vad_write_t write, size_t block_size, uint32_t sample_rate, int channels);
+void vad_gate_submit (void *block, size_t len);
+esp_err_t vad_gate_stop (const char *sidecar_path);
+
+#endif
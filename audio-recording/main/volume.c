@@ -0,0 +1,254 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "volume.h"
+#include "audiosom32_driver.h"
+
+static const char *TAG = "volume.c";
+
+#define VOLUME_OUTPUTS              2
+
+typedef struct
+{
+    audiosom32_volume_t out;
+    float target_db;
+    uint32_t duration_ms;
+    volume_curve_t curve;
+} volume_msg_t;
+
+typedef struct
+{
+    float start_db;
+    float target_db;
+    float current_db;               // Last level written to the codec
+    float min_db;
+    TickType_t start;
+    TickType_t duration;
+    volume_curve_t curve;
+    volatile bool fading;
+} volume_fader_t;
+
+static QueueHandle_t volume_queue = NULL;
+static volume_fader_t faders[VOLUME_OUTPUTS];
+
+/*
+    Level of a fade at position t (0 to 1)
+*/
+static float volume_curve (const volume_fader_t *f, float t)
+{
+    float start, target;
+
+    switch (f->curve)
+    {
+        case VOLUME_CURVE_LINEAR_GAIN:
+            start = powf (10, f->start_db / 20);
+            target = powf (10, f->target_db / 20);
+            start += (target - start) * t;
+            if (start <= powf (10, f->min_db / 20))
+                return f->min_db;
+            return 20 * log10f (start);
+
+        case VOLUME_CURVE_SMOOTH:
+            t = t * t * (3 - 2*t);
+            return f->start_db + (f->target_db - f->start_db) * t;
+
+        case VOLUME_CURVE_LINEAR_DB:
+        default:
+            return f->start_db + (f->target_db - f->start_db) * t;
+    }
+}
+
+/*
+    Write a level if it differs from the last one by at least one 0.5 dB step
+*/
+static void volume_write (audiosom32_volume_t out, float db)
+{
+    volume_fader_t *f = &faders[out];
+
+    if (fabsf (db - f->current_db) < 0.25f)
+        return;
+
+    if (audiosom32_set_volume_db (out, db, db) != ESP_OK)
+        ESP_LOGE (TAG, "Failed to set volume!");
+    f->current_db = db;
+}
+
+/*
+    Control task: takes fade requests and steps running fades
+*/
+static void volume_task (void *pvParameter)
+{
+    volume_msg_t msg;
+    volume_fader_t *f;
+    TickType_t wait, now, elapsed;
+    int i;
+
+    while (1)
+    {
+        wait = portMAX_DELAY;
+        for (i = 0; i < VOLUME_OUTPUTS; i++)
+            if (faders[i].fading)
+                wait = VOLUME_STEP_MS/portTICK_RATE_MS;
+
+        if (xQueueReceive (volume_queue, &msg, wait) == pdTRUE)
+        {
+            // A new fade starts from wherever the output is now
+            f = &faders[msg.out];
+            f->start_db = f->current_db;
+            f->target_db = msg.target_db;
+            f->curve = msg.curve;
+            f->start = xTaskGetTickCount ();
+            f->duration = msg.duration_ms/portTICK_RATE_MS;
+
+            // Short enough for the codec's own ramp/zero-cross detection
+            if (msg.duration_ms <= VOLUME_DIRECT_MS || f->duration == 0)
+            {
+                volume_write (msg.out, f->target_db);
+                f->fading = false;
+            }
+            else
+                f->fading = true;
+        }
+
+        now = xTaskGetTickCount ();
+        for (i = 0; i < VOLUME_OUTPUTS; i++)
+        {
+            f = &faders[i];
+            if (!f->fading)
+                continue;
+
+            elapsed = now - f->start;
+            if (elapsed >= f->duration)
+            {
+                volume_write (i, f->target_db);
+                f->fading = false;
+            }
+            else
+                volume_write (i, volume_curve (f, (float) elapsed / f->duration));
+        }
+    }
+}
+
+/*
+    Start the volume task. The current DAC and HP levels are read from the
+    codec, so call this after audiosom32_playback_init () or
+    audiosom32_record_init ().
+*/
+esp_err_t volume_init (void)
+{
+    float left, right;
+    int i;
+
+    if (volume_queue != NULL)
+        return ESP_OK;
+
+    faders[AUDIOSOM32_VOLUME_DAC].min_db = AUDIOSOM32_DAC_VOL_MIN_DB;
+    faders[AUDIOSOM32_VOLUME_HP].min_db = AUDIOSOM32_HP_VOL_MIN_DB;
+    for (i = 0; i < VOLUME_OUTPUTS; i++)
+    {
+        if (audiosom32_get_volume_db (i, &left, &right) != ESP_OK)
+            return ESP_FAIL;
+        faders[i].current_db = left;
+        faders[i].fading = false;
+    }
+
+    if (audiosom32_set_volume_ramp (1, 0) != ESP_OK || audiosom32_set_hp_zcd (VOLUME_HP_ZCD) != ESP_OK)
+        return ESP_FAIL;
+
+    volume_queue = xQueueCreate (VOLUME_QUEUE_LEN, sizeof (volume_msg_t));
+    if (volume_queue == NULL)
+        return ESP_ERR_NO_MEM;
+
+    if (xTaskCreate (&volume_task, "volume_task", VOLUME_TASK_STACK, NULL, VOLUME_TASK_PRIO, NULL) != pdPASS)
+        return ESP_FAIL;
+
+    return ESP_OK;
+}
+
+/*
+    Fade an output to target_db (both channels) over duration_ms. Replaces
+    any fade already running on that output. Never blocks, so it is safe to
+    call from an audio task: the codec writes happen in the volume task.
+*/
+esp_err_t volume_fade (audiosom32_volume_t out, float target_db, uint32_t duration_ms, volume_curve_t curve)
+{
+    volume_msg_t msg =
+    {
+        .out = out,
+        .target_db = target_db,
+        .duration_ms = duration_ms,
+        .curve = curve
+    };
+
+    if (volume_queue == NULL || out >= VOLUME_OUTPUTS)
+        return ESP_ERR_INVALID_STATE;
+
+    msg.target_db = fminf (fmaxf (target_db, faders[out].min_db),
+                           out == AUDIOSOM32_VOLUME_DAC ? AUDIOSOM32_DAC_VOL_MAX_DB : AUDIOSOM32_HP_VOL_MAX_DB);
+
+    if (xQueueSend (volume_queue, &msg, 0) != pdTRUE)
+        return ESP_FAIL;
+
+    return ESP_OK;
+}
+
+/*
+    Jump to a level, still smoothed by the codec ramp/zero-cross detection
+*/
+esp_err_t volume_set (audiosom32_volume_t out, float target_db)
+{
+    return volume_fade (out, target_db, 0, VOLUME_CURVE_LINEAR_DB);
+}
+
+/*
+    True while a fade on the output is running or still queued
+*/
+bool volume_fading (audiosom32_volume_t out)
+{
+    if (volume_queue == NULL || out >= VOLUME_OUTPUTS)
+        return false;
+
+    return faders[out].fading || uxQueueMessagesWaiting (volume_queue) > 0;
+}
+
+/*
+    Level last written to the codec
+*/
+float volume_get (audiosom32_volume_t out)
+{
+    if (out >= VOLUME_OUTPUTS)
+        return 0;
+
+    return faders[out].current_db;
+}
@@ -0,0 +1,59 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _VOLUME_H_
+#define _VOLUME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "audiosom32_driver.h"
+
+// Shape of a fade between two levels
+typedef enum
+{
+    VOLUME_CURVE_LINEAR_DB = 0,     // Constant dB per second, sounds even for long fades
+    VOLUME_CURVE_LINEAR_GAIN,       // Constant amplitude change, drops away quickly near silence
+    VOLUME_CURVE_SMOOTH             // dB follows an S-curve, gentle at both ends
+} volume_curve_t;
+
+// Interval between stepped volume writes during a fade. Each write is one
+// I2C transaction from the volume task, the audio tasks never touch the codec
+#define VOLUME_STEP_MS              10
+// Fades shorter than this are a single write, smoothed by the codec itself
+// (DAC volume ramp, HP zero-cross detection)
+#define VOLUME_DIRECT_MS            VOLUME_STEP_MS
+// HP volume changes wait for a zero crossing (1) or apply right away (0)
+#define VOLUME_HP_ZCD               1
+#define VOLUME_QUEUE_LEN            4
+#define VOLUME_TASK_STACK           2048
+#define VOLUME_TASK_PRIO            3           // Below every audio task
+
+esp_err_t volume_init (void);
+esp_err_t volume_fade (audiosom32_volume_t out, float target_db, uint32_t duration_ms, volume_curve_t curve);
+esp_err_t volume_set (audiosom32_volume_t out, float target_db);
+bool volume_fading (audiosom32_volume_t out);
+float volume_get (audiosom32_volume_t out);
+
+#endif
@@ -0,0 +1,344 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "esp_log.h"
+
+// Application includes
+#include "wav.h"
+
+static const char *TAG = "wav.c";
+
+_Static_assert (sizeof (wav_header) == WAV_HEADER_SIZE, "wav_header must fill exactly one sector");
+_Static_assert (offsetof (wav_header, fmt_header) == WAV_RF64_PATCH_SIZE, "ds64 placeholder must directly follow WAVE");
+
+/*
+    Fill a PCM WAV header for the given format with empty data chunk.
+    Most players like Audacity and VLC will ignore wave data size descriptor anyway
+*/
+void wav_init_header (wav_header *hdr, uint32_t sample_rate, uint16_t channels, uint16_t bits)
+{
+    uint16_t bytes_per_sample = (bits + 7) / 8;
+
+    memset (hdr, 0, sizeof (wav_header));
+    memcpy (hdr->riff_header, "RIFF", 4);
+    memcpy (hdr->wave_header, "WAVE", 4);
+    memcpy (hdr->ds64_header, "JUNK", 4);
+    hdr->ds64_chunk_size = 28;
+
+    memcpy (hdr->fmt_header, "fmt ", 4);
+    hdr->fmt_chunk_size = 16;
+    hdr->audio_format = 1;
+    hdr->num_channels = channels;
+    hdr->sample_rate = sample_rate;
+    hdr->byte_rate = sample_rate * channels * bytes_per_sample;
+    hdr->sample_alignment = channels * bytes_per_sample;
+    hdr->bit_depth = bits;
+
+    memcpy (hdr->junk_header, "JUNK", 4);
+    hdr->junk_chunk_size = sizeof (hdr->junk);
+
+    memcpy (hdr->data_header, "data", 4);
+    wav_set_data_size (hdr, 0);
+}
+
+/*
+    Update RIFF and data chunk sizes for data_bytes of samples.
+    Past 4 GB the header becomes RF64: the JUNK placeholder turns into ds64
+    with 64 bit sizes and the 32 bit sizes are set to 0xFFFFFFFF. On FAT32
+    the writer moves on to a new file first (WRITER_FILE_LIMIT), RF64 is
+    for file systems that hold bigger files (exFAT).
+*/
+void wav_set_data_size (wav_header *hdr, uint64_t data_bytes)
+{
+    uint64_t riff_size = WAV_HEADER_SIZE - 8 + data_bytes;
+
+    if (riff_size <= UINT32_MAX)
+    {
+        memcpy (hdr->riff_header, "RIFF", 4);
+        memcpy (hdr->ds64_header, "JUNK", 4);
+        hdr->wav_size = (uint32_t) riff_size;
+        hdr->data_size = (uint32_t) data_bytes;
+        hdr->riff_size64 = 0;
+        hdr->data_size64 = 0;
+        hdr->sample_count64 = 0;
+    }
+    else
+    {
+        memcpy (hdr->riff_header, "RF64", 4);
+        memcpy (hdr->ds64_header, "ds64", 4);
+        hdr->wav_size = UINT32_MAX;
+        hdr->data_size = UINT32_MAX;
+        hdr->riff_size64 = riff_size;
+        hdr->data_size64 = data_bytes;
+        hdr->sample_count64 = data_bytes / hdr->sample_alignment;
+    }
+    hdr->table_length = 0;
+}
+
+/*
+    Update the sizes of a WAV file being written through fd, hdr is the header
+    it was created with. Only the first WAV_RF64_PATCH_SIZE bytes and data_size
+    are rewritten, both in the first sector: one sector read and write.
+    The file position goes back to the end so the next write stays sector aligned.
+*/
+esp_err_t wav_patch_sizes (int fd, wav_header *hdr, uint64_t data_bytes)
+{
+    esp_err_t ret = ESP_OK;
+
+    wav_set_data_size (hdr, data_bytes);
+
+    if (lseek (fd, 0, SEEK_SET) != 0 ||
+        write (fd, hdr, WAV_RF64_PATCH_SIZE) != WAV_RF64_PATCH_SIZE)
+        ret = ESP_FAIL;
+    if (lseek (fd, offsetof (wav_header, data_size), SEEK_SET) < 0 ||
+        write (fd, &hdr->data_size, 4) != 4)
+        ret = ESP_FAIL;
+
+    // off_t is 32 bits, positions past 2 GB come back negative, only -1 is an error
+    if (lseek (fd, 0, SEEK_END) == (off_t) -1)
+        return ESP_FAIL;
+
+    return ret;
+}
+
+/*
+    Overwrite len (up to 24) bytes at offset with value unless they already match.
+    Returns true if the file was changed.
+*/
+static bool wav_fix_field (int fd, off_t offset, const void *value, size_t len)
+{
+    uint8_t current[24];
+
+    lseek (fd, offset, SEEK_SET);
+    if (read (fd, current, len) == (ssize_t) len && memcmp (current, value, len) == 0)
+        return false;
+
+    lseek (fd, offset, SEEK_SET);
+    write (fd, value, len);
+    return true;
+}
+
+/*
+    Walk the chunks of a RIFF/RF64 file up to "data", fd is positioned anywhere.
+    Offsets are those of the chunk bodies, 0 when the chunk was not found.
+    A chunk before data that claims to run past the end of the file makes
+    the file invalid, so a bad size can never move the walk back or nowhere.
+*/
+static esp_err_t wav_find_chunks (int fd, uint32_t size, uint32_t *fmt_offset,
+                                  uint32_t *data_offset, uint32_t *ds64_offset)
+{
+    uint8_t chunk[8];
+    uint32_t chunk_size;
+    uint64_t offset;
+
+    *fmt_offset = *data_offset = *ds64_offset = 0;
+    for (offset = 12; offset + 8 <= size; offset += 8 + (uint64_t) chunk_size + (chunk_size & 1))
+    {
+        lseek (fd, offset, SEEK_SET);
+        if (read (fd, chunk, 8) != 8)
+            break;
+        memcpy (&chunk_size, chunk + 4, 4);
+
+        if (memcmp (chunk, "ds64", 4) == 0)
+            *ds64_offset = offset + 8;
+        else if (memcmp (chunk, "fmt ", 4) == 0)
+            *fmt_offset = offset + 8;
+        else if (memcmp (chunk, "data", 4) == 0)
+        {
+            *data_offset = offset + 8;
+            return ESP_OK;
+        }
+
+        if (chunk_size > size - offset - 8)
+            return ESP_ERR_INVALID_SIZE;
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+/*
+    True if fd holds a header written by wav_init_header (): RIFF or RF64,
+    the 28 byte JUNK/ds64 placeholder, PCM fmt, the JUNK padding and data
+    at WAV_HEADER_SIZE. Files from elsewhere (BACKING.WAV, DAW exports with
+    chunks after data) are never touched by the repair.
+*/
+static bool wav_is_own (int fd, wav_header *hdr)
+{
+    lseek (fd, 0, SEEK_SET);
+    if (read (fd, hdr, sizeof (wav_header)) != sizeof (wav_header))
+        return false;
+
+    return (memcmp (hdr->riff_header, "RIFF", 4) == 0 || memcmp (hdr->riff_header, "RF64", 4) == 0) &&
+           memcmp (hdr->wave_header, "WAVE", 4) == 0 &&
+           (memcmp (hdr->ds64_header, "JUNK", 4) == 0 || memcmp (hdr->ds64_header, "ds64", 4) == 0) &&
+           hdr->ds64_chunk_size == 28 &&
+           memcmp (hdr->fmt_header, "fmt ", 4) == 0 && hdr->fmt_chunk_size == 16 &&
+           memcmp (hdr->junk_header, "JUNK", 4) == 0 && hdr->junk_chunk_size == sizeof (hdr->junk) &&
+           memcmp (hdr->data_header, "data", 4) == 0;
+}
+
+/*
+    Fix the RIFF and data chunk sizes of a WAV or RF64 file this recorder
+    wrote and that was not closed properly (power loss, card pulled), based on
+    the actual file length. Data is the last chunk of such a file, so sizes
+    are only ever grown: a size of 0 or one from the last checkpoint is
+    brought up to what the file holds, anything larger is left alone.
+    Trailing bytes that do not make up a whole frame are not counted.
+    FATFS file sizes and off_t are 32 bits, so the file itself is below 4 GB.
+    Returns ESP_ERR_NOT_SUPPORTED for files written by anything else.
+*/
+esp_err_t wav_repair (const char *path, bool *repaired)
+{
+    static wav_header hdr;
+    uint32_t riff_size, data_size, size, align;
+    uint64_t stored, ds64[3];
+    bool rf64;
+    int fd;
+
+    *repaired = false;
+    fd = open (path, O_RDWR);
+    if (fd < 0)
+        return ESP_FAIL;
+
+    size = (uint32_t) lseek (fd, 0, SEEK_END);
+    if (size == UINT32_MAX || size < WAV_HEADER_SIZE || !wav_is_own (fd, &hdr))
+    {
+        close (fd);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    rf64 = (memcmp (hdr.riff_header, "RF64", 4) == 0);
+    align = hdr.sample_alignment > 0 ? hdr.sample_alignment : 1;
+
+    data_size = size - WAV_HEADER_SIZE;
+    data_size -= data_size % align;
+    riff_size = WAV_HEADER_SIZE - 8 + data_size;
+
+    // Only write if the header lags behind the file
+    stored = rf64 ? hdr.data_size64 : hdr.data_size;
+    if (stored < data_size)
+    {
+        if (rf64)
+        {
+            // Riff size, data size and sample count, the 32 bit sizes stay 0xFFFFFFFF
+            ds64[0] = riff_size;
+            ds64[1] = data_size;
+            ds64[2] = data_size / align;
+            *repaired = wav_fix_field (fd, offsetof (wav_header, riff_size64), ds64, sizeof (ds64));
+        }
+        else
+        {
+            *repaired |= wav_fix_field (fd, offsetof (wav_header, wav_size), &riff_size, 4);
+            *repaired |= wav_fix_field (fd, offsetof (wav_header, data_size), &data_size, 4);
+        }
+    }
+
+    close (fd);
+    if (*repaired)
+        ESP_LOGW (TAG, "Repaired %s: %d bytes of samples", path, data_size);
+
+    return ESP_OK;
+}
+
+/*
+    Open a RIFF WAV file for reading, positioned at its first sample.
+    The format is returned in the fmt fields of hdr, data_bytes is what the
+    data chunk holds (limited to what is actually in the file).
+    Returns the file descriptor, -1 on error.
+*/
+int wav_open_read (const char *path, wav_header *hdr, uint32_t *data_bytes)
+{
+    uint8_t riff[12];
+    uint32_t size, fmt_offset, data_offset, ds64_offset;
+    int fd;
+
+    fd = open (path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    size = (uint32_t) lseek (fd, 0, SEEK_END);
+    lseek (fd, 0, SEEK_SET);
+    memset (hdr, 0, sizeof (wav_header));
+    if (size == UINT32_MAX || read (fd, riff, 12) != 12 || memcmp (riff, "RIFF", 4) != 0 ||
+        memcmp (riff + 8, "WAVE", 4) != 0 ||
+        wav_find_chunks (fd, size, &fmt_offset, &data_offset, &ds64_offset) != ESP_OK || fmt_offset == 0)
+    {
+        close (fd);
+        return -1;
+    }
+
+    // PCM fmt body is audio_format through bit_depth
+    lseek (fd, fmt_offset, SEEK_SET);
+    if (read (fd, (uint8_t *) hdr + offsetof (wav_header, audio_format), 16) != 16)
+    {
+        close (fd);
+        return -1;
+    }
+
+    lseek (fd, data_offset - 4, SEEK_SET);
+    read (fd, &hdr->data_size, 4);
+    *data_bytes = hdr->data_size;
+    if (*data_bytes > size - data_offset)
+        *data_bytes = size - data_offset;
+
+    return fd;
+}
+
+/*
+    Check every .WAV file in dir and repair truncated headers of those this
+    recorder wrote (see wav_repair ()). Returns the number of repaired files.
+*/
+int wav_repair_all (const char *dir)
+{
+    DIR *d;
+    struct dirent *entry;
+    char path[64];
+    size_t len;
+    bool repaired;
+    int count = 0;
+
+    d = opendir (dir);
+    if (d == NULL)
+        return 0;
+
+    while ((entry = readdir (d)) != NULL)
+    {
+        len = strlen (entry->d_name);
+        if (len < 4 || strcasecmp (entry->d_name + len - 4, ".WAV") != 0)
+            continue;
+
+        snprintf (path, sizeof (path), "%s/%s", dir, entry->d_name);
+        if (wav_repair (path, &repaired) == ESP_OK && repaired)
+            count++;
+    }
+    closedir (d);
+
+    return count;
+}
@@ -0,0 +1,79 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _WAV_H_
+#define _WAV_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// WAV header is padded to one sector so that samples stay sector aligned
+#define WAV_HEADER_SIZE     512
+// Bytes at the start of the header that change when a file becomes RF64
+#define WAV_RF64_PATCH_SIZE 48
+
+typedef struct __attribute__((packed)) wav_header
+{
+    // RIFF Header
+    uint8_t riff_header[4]; // Contains "RIFF", or "RF64" once the file is past 4 GB
+    uint32_t wav_size; // Size of the wav portion of the file, which follows the first 8 bytes. File size - 8
+    uint8_t wave_header[4]; // Contains "WAVE"
+
+    // Placeholder for the RF64 ds64 chunk (EBU Tech 3306), must be the first chunk
+    uint8_t ds64_header[4]; // Contains "JUNK", or "ds64" in RF64 files
+    uint32_t ds64_chunk_size; // 28
+    uint64_t riff_size64; // 64 bit wav_size, wav_size is then 0xFFFFFFFF
+    uint64_t data_size64; // 64 bit data_size, data_size is then 0xFFFFFFFF
+    uint64_t sample_count64; // Number of sample frames
+    uint32_t table_length; // No further 64 bit chunk sizes, 0
+    
+    // Format Header
+    uint8_t fmt_header[4]; // Contains "fmt " (includes trailing space)
+    uint32_t fmt_chunk_size; // Should be 16 for PCM
+    uint16_t audio_format; // Should be 1 for PCM. 3 for IEEE Float
+    uint16_t num_channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate; // Number of bytes per second. sample_rate * num_channels * Bytes Per Sample
+    uint16_t sample_alignment; // num_channels * Bytes Per Sample
+    uint16_t bit_depth; // Number of bits per sample
+
+    // Padding up to WAV_HEADER_SIZE, players skip unknown chunks
+    uint8_t junk_header[4]; // Contains "JUNK"
+    uint32_t junk_chunk_size; // Size of junk[]
+    uint8_t junk[WAV_HEADER_SIZE - 88];
+    
+    // Data
+    uint8_t data_header[4]; // Contains "data"
+    uint32_t data_size; // Number of bytes of samples that follow
+} wav_header;
+
+void wav_init_header (wav_header *hdr, uint32_t sample_rate, uint16_t channels, uint16_t bits);
+void wav_set_data_size (wav_header *hdr, uint64_t data_bytes);
+esp_err_t wav_patch_sizes (int fd, wav_header *hdr, uint64_t data_bytes);
+esp_err_t wav_repair (const char *path, bool *repaired);
+int wav_repair_all (const char *dir);
+int wav_open_read (const char *path, wav_header *hdr, uint32_t *data_bytes);
+
+#endif
@@ -0,0 +1,497 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+// System includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "xtensa/hal.h"
+#include "sdkconfig.h"
+
+// Application includes
+#include "writer.h"
+#include "audio_pm.h"
+#include "rawrec.h"
+
+static const char *TAG = "writer.c";
+
+typedef enum
+{
+    WRITER_CMD_DATA = 0,
+    WRITER_CMD_CLOSE
+} writer_cmd_t;
+
+// Queue entries carry a pointer to the block, never the samples themselves
+typedef struct
+{
+    writer_cmd_t cmd;
+    int stream;
+    audio_block_pool_t *pool;           // Where the block goes back once written
+    void *block;
+    size_t len;
+} writer_msg_t;
+
+typedef struct
+{
+    int fd;
+    wav_header header;                  // Sizes are patched into the file from this copy
+    bool raw;                           // Blocks go to the raw region instead of fd
+    volatile bool error;                // Set by the writer task, blocks are no longer written
+    uint32_t drops;                     // Blocks given back unwritten, the queue was full
+    char path[WRITER_PATH_LEN];         // First file, the name parts are made from
+    int part;                           // File being written, 0 is path itself
+    uint64_t file_bytes;                // Samples in the file being written
+    SemaphoreHandle_t drained;          // Given by the writer task when a close request is reached
+    uint64_t bytes;
+    uint32_t blocks;
+    int64_t opened_us;
+    int64_t write_us;                   // Total time spent inside write ()
+    int64_t write_max_us;
+    int64_t checkpoint_at_us;           // Time of the last header patch and fsync ()
+    int64_t checkpoint_max_us;
+    uint32_t checkpoints;
+} writer_stream_t;
+
+static QueueHandle_t writer_queue = NULL;
+static writer_stream_t streams[WRITER_MAX_STREAMS];
+
+/*
+    Make everything written so far survive a power loss: correct the WAV sizes
+    and flush FATFS (data, FAT and directory entry) to the card
+*/
+static void writer_checkpoint (writer_stream_t *s)
+{
+    int64_t start, elapsed;
+
+    start = esp_timer_get_time ();
+    if (wav_patch_sizes (s->fd, &s->header, s->file_bytes) != ESP_OK || fsync (s->fd) != 0)
+    {
+        ESP_LOGE (TAG, "Checkpoint failed after %d KB", (uint32_t) (s->bytes / 1024));
+        s->error = true;
+    }
+    elapsed = esp_timer_get_time () - start;
+
+    s->checkpoint_at_us = start + elapsed;
+    s->checkpoints++;
+    if (elapsed > s->checkpoint_max_us)
+        s->checkpoint_max_us = elapsed;
+}
+
+/*
+    Name of file part of a stream: path itself for part 0, then the part
+    number in front of the extension ("/sdcard/REC.WAV" -> "/sdcard/REC01.WAV")
+*/
+static void writer_part_path (const char *path, int part, char *out, size_t len)
+{
+    const char *ext;
+
+    ext = strrchr (path, '.');
+    if (part == 0 || ext == NULL)
+        snprintf (out, len, "%s", path);
+    else
+        snprintf (out, len, "%.*s%02d%s", (int) (ext - path), path, part, ext);
+}
+
+/*
+    Finish the file of a stream and go on in the next part, with the same
+    header. The old file is only closed once the new one exists, so a failure
+    leaves the stream on a file writer_close () can still finish.
+*/
+static void writer_next_part (writer_stream_t *s, int stream)
+{
+    char path[WRITER_PATH_LEN];
+    int fd;
+
+    writer_part_path (s->path, s->part + 1, path, sizeof (path));
+    fd = (s->part < WRITER_MAX_PARTS) ? open (path, O_WRONLY | O_CREAT | O_TRUNC) : -1;
+    if (fd < 0)
+    {
+        ESP_LOGE (TAG, "Stream %d: file full and %s not created", stream, path);
+        s->error = true;
+        return;
+    }
+
+    if (wav_patch_sizes (s->fd, &s->header, s->file_bytes) != ESP_OK)
+        s->error = true;
+    close (s->fd);
+    s->fd = fd;
+    s->part++;
+    s->file_bytes = 0;
+
+    wav_set_data_size (&s->header, 0);
+    if (write (s->fd, &s->header, sizeof (wav_header)) != sizeof (wav_header))
+    {
+        ESP_LOGE (TAG, "Failed to write header of %s", path);
+        s->error = true;
+        return;
+    }
+    ESP_LOGW (TAG, "Stream %d: continued in %s", stream, path);
+}
+
+static void writer_task (void *pvParameter)
+{
+    writer_msg_t msg;
+    writer_stream_t *s;
+    int64_t start, elapsed;
+    ssize_t ret;
+
+    while (1)
+    {
+        xQueueReceive (writer_queue, &msg, portMAX_DELAY);
+        s = &streams[msg.stream];
+
+        if (msg.cmd == WRITER_CMD_CLOSE)
+        {
+            xSemaphoreGive (s->drained);
+            continue;
+        }
+
+        // Straight from the pool block to FATFS. Blocks are DMA-capable, word aligned
+        // and start on a sector boundary in the file, so whole sectors go to the card
+        // without passing through stdio or the SDMMC bounce buffer
+        if (!s->raw && s->fd >= 0 && !s->error &&
+            WAV_HEADER_SIZE + s->file_bytes + msg.len > WRITER_FILE_LIMIT)
+            writer_next_part (s, msg.stream);
+
+        // No audio_pm_work_begin () here: the task mostly waits for the card,
+        // the CPU does not need to run at max frequency for that
+        if ((s->fd >= 0 || s->raw) && !s->error)
+        {
+            start = esp_timer_get_time ();
+            if (s->raw)
+                ret = (rawrec_write (msg.block, msg.len) == ESP_OK) ? msg.len : -1;
+            else
+                ret = write (s->fd, msg.block, msg.len);
+            elapsed = esp_timer_get_time () - start;
+
+            if (ret != (ssize_t) msg.len)
+            {
+                ESP_LOGE (TAG, "Stream %d: write failed after %d KB", msg.stream, (uint32_t) (s->bytes / 1024));
+                s->error = true;
+            }
+            else
+            {
+                s->bytes += msg.len;
+                s->file_bytes += msg.len;
+                s->blocks++;
+                s->write_us += elapsed;
+                if (elapsed > s->write_max_us)
+                    s->write_max_us = elapsed;
+            }
+
+            // The capture task keeps filling other blocks while this runs
+            if (WRITER_CHECKPOINT_MS > 0 && !s->raw && !s->error &&
+                start - s->checkpoint_at_us >= WRITER_CHECKPOINT_MS * 1000LL)
+                writer_checkpoint (s);
+        }
+
+        audio_block_put (msg.pool, msg.block);
+    }
+}
+
+static void writer_reset_stats (writer_stream_t *s)
+{
+    s->error = false;
+    s->drops = 0;
+    s->part = 0;
+    s->file_bytes = 0;
+    s->bytes = 0;
+    s->blocks = 0;
+    s->write_us = 0;
+    s->write_max_us = 0;
+    s->checkpoint_max_us = 0;
+    s->checkpoints = 0;
+    s->opened_us = esp_timer_get_time ();
+    s->checkpoint_at_us = s->opened_us;
+}
+
+esp_err_t writer_init (void)
+{
+    int i;
+
+    if (writer_queue != NULL)
+        return ESP_OK;
+
+    for (i = 0; i < WRITER_MAX_STREAMS; i++)
+    {
+        streams[i].fd = -1;
+        streams[i].drained = xSemaphoreCreateBinary ();
+        if (streams[i].drained == NULL)
+            return ESP_ERR_NO_MEM;
+    }
+
+    writer_queue = xQueueCreate (WRITER_QUEUE_LEN, sizeof (writer_msg_t));
+    if (writer_queue == NULL)
+        return ESP_ERR_NO_MEM;
+
+    if (xTaskCreate (&writer_task, "writer_task", WRITER_TASK_STACK, NULL, WRITER_TASK_PRIO, NULL) != pdPASS)
+        return ESP_FAIL;
+
+    return ESP_OK;
+}
+
+/*
+    Create (or overwrite) a WAV file for a stream and write its header.
+    The stream must be closed. Sizes in the header are kept up to date by
+    the writer, the header is one sector so the blocks stay sector aligned.
+    Parts left over from an earlier, longer recording to path are deleted.
+*/
+esp_err_t writer_open (int stream, const char *path, const wav_header *header)
+{
+    writer_stream_t *s;
+    char part_path[WRITER_PATH_LEN];
+    int part;
+
+    if (stream < 0 || stream >= WRITER_MAX_STREAMS || streams[stream].fd >= 0 || streams[stream].raw ||
+        strlen (path) + 3 > WRITER_PATH_LEN)
+        return ESP_ERR_INVALID_ARG;
+
+    s = &streams[stream];
+    strcpy (s->path, path);
+    for (part = 1; part <= WRITER_MAX_PARTS; part++)
+    {
+        writer_part_path (path, part, part_path, sizeof (part_path));
+        if (unlink (part_path) != 0)
+            break;
+    }
+
+    s->fd = open (path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (s->fd < 0)
+    {
+        ESP_LOGE (TAG, "Failed to create %s", path);
+        return ESP_FAIL;
+    }
+
+    writer_reset_stats (s);
+
+    s->header = *header;
+    if (write (s->fd, &s->header, sizeof (wav_header)) != sizeof (wav_header))
+    {
+        ESP_LOGE (TAG, "Failed to write header of %s", path);
+        // Closed again, or the stream could never be opened after this
+        close (s->fd);
+        s->fd = -1;
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+/*
+    Like writer_open, but blocks are written to the raw region of the card
+    (see rawrec.c) and become a WAV file after writer_close ()
+*/
+esp_err_t writer_open_raw (int stream, uint32_t sample_rate, uint16_t channels, uint16_t bits)
+{
+    writer_stream_t *s;
+
+    if (stream < 0 || stream >= WRITER_MAX_STREAMS || streams[stream].fd >= 0 || streams[stream].raw)
+        return ESP_ERR_INVALID_ARG;
+
+    if (rawrec_start (sample_rate, channels, bits) != ESP_OK)
+    {
+        ESP_LOGE (TAG, "Raw region not ready");
+        return ESP_FAIL;
+    }
+
+    s = &streams[stream];
+    s->raw = true;
+    writer_reset_stats (s);
+
+    return ESP_OK;
+}
+
+/*
+    Hand a filled block over to the writer task. Ownership passes to the
+    writer, which returns the block to pool once it is on the card.
+    ESP_ERR_INVALID_STATE once a write to the stream has failed (card
+    full, removed or the last part used up): the block goes back to pool
+    and the caller should stop or warn, nothing more reaches the file.
+*/
+esp_err_t writer_submit (int stream, audio_block_pool_t *pool, void *block, size_t len)
+{
+    writer_msg_t msg =
+    {
+        .cmd = WRITER_CMD_DATA,
+        .stream = stream,
+        .pool = pool,
+        .block = block,
+        .len = len
+    };
+
+    if (streams[stream].error)
+    {
+        audio_block_put (pool, block);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The capture never waits for the card, a full queue costs the block
+    if (xQueueSend (writer_queue, &msg, 0) != pdTRUE)
+    {
+        streams[stream].drops++;
+        audio_block_put (pool, block);
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+/*
+    Wait until every block submitted so far is written, then close the file
+*/
+esp_err_t writer_close (int stream)
+{
+    writer_stream_t *s;
+    writer_msg_t msg =
+    {
+        .cmd = WRITER_CMD_CLOSE,
+        .stream = stream
+    };
+
+    if (stream < 0 || stream >= WRITER_MAX_STREAMS || (streams[stream].fd < 0 && !streams[stream].raw))
+        return ESP_ERR_INVALID_ARG;
+
+    s = &streams[stream];
+    xQueueSend (writer_queue, &msg, portMAX_DELAY);
+    xSemaphoreTake (s->drained, portMAX_DELAY);
+
+    if (s->raw)
+    {
+        if (rawrec_stop () != ESP_OK)
+            s->error = true;
+        s->raw = false;
+    }
+    else
+    {
+        if (wav_patch_sizes (s->fd, &s->header, s->file_bytes) != ESP_OK)
+            s->error = true;
+        close (s->fd);
+        s->fd = -1;
+    }
+
+    return s->error ? ESP_FAIL : ESP_OK;
+}
+
+/*
+    Throughput and time spent writing for the last (or current) file of a stream.
+    write () time includes waiting for the card, so it is an upper bound for the
+    CPU time the writer task needed.
+*/
+void writer_report (int stream)
+{
+    writer_stream_t *s;
+    int64_t elapsed;
+
+    if (stream < 0 || stream >= WRITER_MAX_STREAMS)
+        return;
+
+    s = &streams[stream];
+    elapsed = esp_timer_get_time () - s->opened_us;
+    if (s->blocks == 0 || elapsed <= 0)
+        return;
+
+    ESP_LOGI (TAG, "Stream %d: %d KB in %d blocks and %d files, %d KB/s", stream,
+        (uint32_t) (s->bytes / 1024), s->blocks, s->part + 1, (uint32_t) (s->bytes * 1000000 / elapsed / 1024));
+    ESP_LOGI (TAG, "Stream %d: write () avg %d us, max %d us, busy %d%% of the time", stream,
+        (uint32_t) (s->write_us / s->blocks), (uint32_t) s->write_max_us,
+        (uint32_t) (s->write_us * 100 / elapsed));
+    if (s->checkpoints > 0)
+        ESP_LOGI (TAG, "Stream %d: %d checkpoints, max %d us", stream,
+            s->checkpoints, (uint32_t) s->checkpoint_max_us);
+    if (s->drops > 0)
+        ESP_LOGW (TAG, "Stream %d: %d blocks dropped, the writer queue was full (gaps in the file)",
+            stream, s->drops);
+}
+
+/*
+    CPU cost of handing a block to the writer, in cycles per block and share
+    of one core at bytes_per_second. Before blocks went by pointer, each one
+    was copied into the stdio buffer and again into the SDMMC bounce buffer;
+    now only a queue entry is sent and received.
+*/
+esp_err_t writer_bench_run (uint32_t bytes_per_second)
+{
+    uint8_t *block, *stdio_buf, *bounce;
+    QueueHandle_t queue;
+    writer_msg_t msg = { .cmd = WRITER_CMD_DATA, .len = WRITER_BENCH_BLOCK_SIZE };
+    uint32_t start, copy_cycles = 0, queue_cycles = 0, blocks_per_second;
+    int b;
+
+    block = heap_caps_malloc (WRITER_BENCH_BLOCK_SIZE, MALLOC_CAP_DMA);
+    stdio_buf = heap_caps_malloc (WRITER_BENCH_BLOCK_SIZE, MALLOC_CAP_8BIT);
+    bounce = heap_caps_malloc (WRITER_BENCH_BLOCK_SIZE, MALLOC_CAP_DMA);
+    queue = xQueueCreate (1, sizeof (writer_msg_t));
+    if (block == NULL || stdio_buf == NULL || bounce == NULL || queue == NULL)
+    {
+        ESP_LOGE (TAG, "Not enough memory for the writer benchmark");
+        free (block);
+        free (stdio_buf);
+        free (bounce);
+        if (queue != NULL)
+            vQueueDelete (queue);
+        return ESP_ERR_NO_MEM;
+    }
+    memset (block, 0x55, WRITER_BENCH_BLOCK_SIZE);
+    msg.block = block;
+
+    audio_pm_work_begin ();
+    for (b = 0; b < WRITER_BENCH_BLOCKS; b++)
+    {
+        start = xthal_get_ccount ();
+        memcpy (stdio_buf, block, WRITER_BENCH_BLOCK_SIZE);
+        memcpy (bounce, stdio_buf, WRITER_BENCH_BLOCK_SIZE);
+        copy_cycles += xthal_get_ccount () - start;
+
+        start = xthal_get_ccount ();
+        xQueueSend (queue, &msg, 0);
+        xQueueReceive (queue, &msg, 0);
+        queue_cycles += xthal_get_ccount () - start;
+    }
+    audio_pm_work_end ();
+
+    copy_cycles /= WRITER_BENCH_BLOCKS;
+    queue_cycles /= WRITER_BENCH_BLOCKS;
+    blocks_per_second = bytes_per_second / WRITER_BENCH_BLOCK_SIZE;
+    ESP_LOGI (TAG, "%d byte block: two copies %d cycles, pointer hand-off %d cycles", WRITER_BENCH_BLOCK_SIZE,
+        copy_cycles, queue_cycles);
+    ESP_LOGI (TAG, "At %d KB/s that saves %d.%02d%% of one core", bytes_per_second / 1024,
+        (int) ((uint64_t) (copy_cycles - queue_cycles) * blocks_per_second / (CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ * 10000)),
+        (int) ((uint64_t) (copy_cycles - queue_cycles) * blocks_per_second / (CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ * 100) % 100));
+
+    vQueueDelete (queue);
+    free (block);
+    free (stdio_buf);
+    free (bounce);
+
+    return ESP_OK;
+}
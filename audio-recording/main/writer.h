@@ -0,0 +1,61 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _WRITER_H_
+#define _WRITER_H_
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "audio_mem.h"
+#include "wav.h"
+
+// Number of files that can be written at the same time
+#define WRITER_MAX_STREAMS          2
+// Blocks that can wait for the SD card, should be >= number of blocks in all pools
+#define WRITER_QUEUE_LEN            16
+#define WRITER_TASK_STACK           4096
+#define WRITER_TASK_PRIO            7           // Below the capture task
+// WAV sizes are patched and the file is synced this often while recording,
+// so at most this much audio is lost when power fails. 0 disables it
+#define WRITER_CHECKPOINT_MS        5000
+// FAT32 files end at 4 GB - 1. A recording that would pass it continues in
+// a new file with a two digit part number (REC.WAV, REC01.WAV, REC02.WAV...)
+#define WRITER_FILE_LIMIT           0xFFFFFFFFULL
+#define WRITER_MAX_PARTS            99
+#define WRITER_PATH_LEN             32
+// Measure the block hand-off at boot (1) or never (0): two copies of each
+// block as the stdio path did, against queueing its pointer
+#define WRITER_BENCH_AT_BOOT        0
+#define WRITER_BENCH_BLOCK_SIZE     2048
+#define WRITER_BENCH_BLOCKS         64
+
+esp_err_t writer_init (void);
+esp_err_t writer_open (int stream, const char *path, const wav_header *header);
+esp_err_t writer_open_raw (int stream, uint32_t sample_rate, uint16_t channels, uint16_t bits);
+esp_err_t writer_submit (int stream, audio_block_pool_t *pool, void *block, size_t len);
+esp_err_t writer_close (int stream);
+void writer_report (int stream);
+esp_err_t writer_bench_run (uint32_t bytes_per_second);
+
+#endif
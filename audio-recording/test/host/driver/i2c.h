@@ -0,0 +1,5 @@
+/* Host stand-in for the ESP-IDF header of the same name, only what the tested modules use */
+#pragma once
+#include "esp_err.h"
+#include "driver/gpio.h"
+typedef int i2c_port_t;
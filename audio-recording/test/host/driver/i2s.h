@@ -0,0 +1,10 @@
+/* Host stand-in for the ESP-IDF header of the same name, only what the tested modules use */
+#pragma once
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+typedef int i2s_port_t;
+typedef enum { I2S_BITS_PER_SAMPLE_16BIT = 16, I2S_BITS_PER_SAMPLE_24BIT = 24, I2S_BITS_PER_SAMPLE_32BIT = 32 } i2s_bits_per_sample_t;
+esp_err_t i2s_read (i2s_port_t port, void *dest, size_t size, size_t *bytes_read, TickType_t wait);
+esp_err_t i2s_write (i2s_port_t port, const void *src, size_t size, size_t *bytes_written, TickType_t wait);
+esp_err_t i2s_zero_dma_buffer (i2s_port_t port);
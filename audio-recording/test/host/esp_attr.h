@@ -0,0 +1,8 @@
+/* Host stand-in for the ESP-IDF header of the same name, only what the tested modules use */
+#pragma once
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+#ifndef DRAM_ATTR
+#define DRAM_ATTR
+#endif
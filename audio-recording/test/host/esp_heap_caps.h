@@ -0,0 +1,9 @@
+/* Host stand-in for the ESP-IDF header of the same name, only what the tested modules use */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#define MALLOC_CAP_32BIT            (1<<1)
+#define MALLOC_CAP_8BIT             (1<<2)
+#define MALLOC_CAP_DMA              (1<<3)
+#define MALLOC_CAP_INTERNAL         (1<<11)
+void *heap_caps_malloc (size_t size, uint32_t caps);
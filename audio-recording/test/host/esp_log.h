@@ -0,0 +1,13 @@
+/* Host stand-in for the ESP-IDF header of the same name, only what the tested modules use */
+#pragma once
+#include <stdio.h>
+// Module logging is kept quiet unless HOST_LOG is defined, the tests print their own results
+#ifdef HOST_LOG
+#define ESP_LOG_HOST(fmt, ...)      printf (fmt "\n", ##__VA_ARGS__)
+#else
+#define ESP_LOG_HOST(fmt, ...)      do { if (0) printf (fmt, ##__VA_ARGS__); } while (0)
+#endif
+#define ESP_LOGE(tag, fmt, ...)     ESP_LOG_HOST (fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...)     ESP_LOG_HOST (fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...)     ESP_LOG_HOST (fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...)     ESP_LOG_HOST (fmt, ##__VA_ARGS__)
@@ -0,0 +1,20 @@
+/* Host stand-in for the ESP-IDF header of the same name, only what the tested modules use */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+#define portMAX_DELAY               0xffffffffu
+#define portTICK_RATE_MS            10
+#define portTICK_PERIOD_MS          10
+#define pdMS_TO_TICKS(x)            ((x) / 10)
+#define pdPASS                      1
+#define pdFAIL                      0
+#define pdTRUE                      1
+#define pdFALSE                     0
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux)     (void) (mux)
+#define portEXIT_CRITICAL(mux)      (void) (mux)
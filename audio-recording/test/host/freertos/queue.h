@@ -0,0 +1,7 @@
+/* Host stand-in for the ESP-IDF header of the same name, only what the tested modules use */
+#pragma once
+#include "FreeRTOS.h"
+typedef void *QueueHandle_t;
+QueueHandle_t xQueueCreate (UBaseType_t length, UBaseType_t item_size);
+BaseType_t xQueueSend (QueueHandle_t queue, const void *item, TickType_t wait);
+BaseType_t xQueueReceive (QueueHandle_t queue, void *item, TickType_t wait);
@@ -0,0 +1,4 @@
+/* Host stand-in for the ESP-IDF header of the same name, only what the tested modules use */
+#pragma once
+#include "queue.h"
+typedef void *SemaphoreHandle_t;
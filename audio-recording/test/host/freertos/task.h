@@ -0,0 +1,8 @@
+/* Host stand-in for the ESP-IDF header of the same name, only what the tested modules use */
+#pragma once
+#include "FreeRTOS.h"
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t) (void *);
+BaseType_t xTaskCreate (TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio, TaskHandle_t *handle);
+void vTaskDelay (TickType_t ticks);
+TickType_t xTaskGetTickCount (void);
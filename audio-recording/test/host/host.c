@@ -0,0 +1,197 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+/*
+    Host implementations of the few ESP-IDF and application calls the tested
+    modules make. Hardware calls fail, so code paths that need the codec or
+    the SD card are not run on the host.
+*/
+
+// System includes
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+// Application includes
+#include "host_test.h"
+#include "esp_heap_caps.h"
+#include "xtensa/hal.h"
+#include "freertos/task.h"
+#include "driver/i2s.h"
+#include "audiosom32_driver.h"
+#include "audio_mem.h"
+#include "audio_pm.h"
+#include "writer.h"
+
+int test_failures = 0;
+uint32_t test_blocks_returned = 0;
+void (*test_writer_hook) (int stream, void *block, size_t len) = NULL;
+int32_t test_i2s_loopback = -1;
+
+// I2S loopback: frames written, in the order they come back on the input
+#define LOOP_FRAMES 16384
+static int16_t loop_buf[LOOP_FRAMES * 2];
+static uint32_t loop_head, loop_fill;
+
+static uint32_t noise_state = 1;
+
+void test_srand (uint32_t seed)
+{
+    noise_state = seed ? seed : 1;
+}
+
+float test_noise (void)
+{
+    // xorshift32
+    noise_state ^= noise_state << 13;
+    noise_state ^= noise_state >> 17;
+    noise_state ^= noise_state << 5;
+    return (int32_t) noise_state / 2147483648.0f;
+}
+
+void *heap_caps_malloc (size_t size, uint32_t caps)
+{
+    return malloc (size);
+}
+
+uint32_t xthal_get_ccount (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+BaseType_t xTaskCreate (TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio, TaskHandle_t *handle)
+{
+    return pdFAIL;
+}
+
+void vTaskDelay (TickType_t ticks)
+{
+}
+
+TickType_t xTaskGetTickCount (void)
+{
+    return 0;
+}
+
+int32_t test_i2s_delay (int buf_count, int buf_len)
+{
+    return (1 + buf_count) * buf_len + test_i2s_loopback;
+}
+
+// Frames not written yet read as silence
+esp_err_t i2s_read (i2s_port_t port, void *dest, size_t size, size_t *bytes_read, TickType_t wait)
+{
+    int16_t *out = dest;
+    size_t i;
+
+    *bytes_read = 0;
+    if (test_i2s_loopback < 0)
+        return ESP_FAIL;
+
+    for (i = 0; i < size / 4; i++, out += 2)
+    {
+        if (loop_fill == 0)
+        {
+            out[0] = out[1] = 0;
+            continue;
+        }
+        out[0] = loop_buf[2 * loop_head];
+        out[1] = loop_buf[2 * loop_head + 1];
+        loop_head = (loop_head + 1) % LOOP_FRAMES;
+        loop_fill--;
+    }
+    *bytes_read = size;
+    return ESP_OK;
+}
+
+// Frames that would overflow the loop are dropped
+esp_err_t i2s_write (i2s_port_t port, const void *src, size_t size, size_t *bytes_written, TickType_t wait)
+{
+    const int16_t *in = src;
+    uint32_t tail;
+    size_t i;
+
+    *bytes_written = 0;
+    if (test_i2s_loopback < 0)
+        return ESP_FAIL;
+
+    for (i = 0; i < size / 4 && loop_fill < LOOP_FRAMES; i++, in += 2)
+    {
+        tail = (loop_head + loop_fill) % LOOP_FRAMES;
+        loop_buf[2 * tail] = in[0];
+        loop_buf[2 * tail + 1] = in[1];
+        loop_fill++;
+    }
+    *bytes_written = size;
+    return ESP_OK;
+}
+
+esp_err_t i2s_zero_dma_buffer (i2s_port_t port)
+{
+    return (test_i2s_loopback < 0) ? ESP_FAIL : ESP_OK;
+}
+
+// The loop restarts with test_i2s_delay () frames of silence queued
+esp_err_t audiosom32_i2s_set_dma (int buf_count, int buf_len)
+{
+    if (test_i2s_loopback < 0)
+        return ESP_FAIL;
+
+    memset (loop_buf, 0, sizeof (loop_buf));
+    loop_head = 0;
+    loop_fill = test_i2s_delay (buf_count, buf_len);
+    return ESP_OK;
+}
+
+void audio_pm_work_begin (void)
+{
+}
+
+void audio_pm_work_end (void)
+{
+}
+
+// Blocks are plain malloc () buffers on the host. They are never freed, so
+// a block keeps its address for the whole test and can be told apart
+void *audio_block_get (audio_block_pool_t *bp, TickType_t wait)
+{
+    return malloc (bp->block_size);
+}
+
+void audio_block_put (audio_block_pool_t *bp, void *block)
+{
+    test_blocks_returned++;
+}
+
+esp_err_t writer_submit (int stream, audio_block_pool_t *pool, void *block, size_t len)
+{
+    if (test_writer_hook != NULL)
+        test_writer_hook (stream, block, len);
+    audio_block_put (pool, block);
+    return ESP_OK;
+}
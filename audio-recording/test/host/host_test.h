@@ -0,0 +1,64 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Print a check and count it if it failed, main () returns test_failures
+#define TEST_CHECK(cond, ...)                                   \
+    do                                                          \
+    {                                                           \
+        if (cond)                                               \
+            printf ("  ok    ");                                \
+        else                                                    \
+        {                                                       \
+            printf ("  FAIL  ");                                \
+            test_failures++;                                    \
+        }                                                       \
+        printf (__VA_ARGS__);                                   \
+        printf ("\n");                                          \
+    } while (0)
+
+extern int test_failures;
+
+// Repeatable white noise, uniform in [-1, 1)
+void test_srand (uint32_t seed);
+float test_noise (void);
+
+// Called for every block a module hands to writer_submit () (NULL: blocks are just returned)
+extern void (*test_writer_hook) (int stream, void *block, size_t len);
+// Blocks given back with audio_block_put (), also those writer_submit () took
+extern uint32_t test_blocks_returned;
+
+// Mock I2S loopback: what i2s_write () sends comes back from i2s_read ()
+// test_i2s_delay () frames later, the DMA buffering plus test_i2s_loopback
+// frames of codec delay. Negative (default): no I2S, every call fails
+extern int32_t test_i2s_loopback;
+int32_t test_i2s_delay (int buf_count, int buf_len);
+
+#endif
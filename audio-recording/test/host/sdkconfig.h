@@ -0,0 +1,4 @@
+/* Host stand-in for the ESP-IDF header of the same name, only what the tested modules use */
+#pragma once
+#define CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ   160
+#define CONFIG_PM_ENABLE                    0
@@ -0,0 +1,5 @@
+/* Host stand-in for the ESP-IDF header of the same name, only what the tested modules use */
+#pragma once
+#include <stdint.h>
+// Host clock in place of the CPU cycle counter, figures are host ns, not ESP32 cycles
+uint32_t xthal_get_ccount (void);
@@ -0,0 +1,159 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+/*
+    Every biquad kernel against a double precision Direct Form I reference
+    with the same coefficients, on -12 dBFS white noise: mean error (DC the
+    kernel adds) and RMS error in LSBs, plus host time per sample. Ideal
+    rounding of the output alone is 0.29 LSB RMS.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+
+// Application includes
+#include "host_test.h"
+#include "../main/biquad.c"
+
+#define TEST_FRAMES         (AUDIOSOM32_SAMPLERATE * 2)
+#define TEST_BLOCK          256
+
+typedef struct
+{
+    const char *name;
+    int sections;
+    struct
+    {
+        biquad_type_t type;
+        float freq, q, gain_db;
+    } eq[BIQUAD_BENCH_SECTIONS];
+    float max_rms_int;              // Limit for the int kernels, LSB
+} test_filter_t;
+
+static const test_filter_t filters[] =
+{
+    { "30 Hz high-pass", 1, { { BIQUAD_HIGHPASS, 30, 0.707f, 0 } }, 0.5f },
+    { "50 Hz low-pass", 1, { { BIQUAD_LOWPASS, 50, 0.707f, 0 } }, 0.5f },
+    { "1 kHz peak +6 dB", 1, { { BIQUAD_PEAK, 1000, 2.0f, 6 } }, 0.5f },
+    // Same cascade as biquad_bench_run ()
+    { "bench EQ", 4,
+        {
+            { BIQUAD_HIGHPASS, 30, 0.707f, 0 },
+            { BIQUAD_LOWSHELF, 120, 0.707f, 4 },
+            { BIQUAD_PEAK, 2500, 1.5f, -3 },
+            { BIQUAD_HIGHSHELF, 8000, 0.707f, 2 },
+        }, 1.0f },              // Every section rounds its output
+};
+
+static int16_t input[TEST_FRAMES * 2];
+static int16_t output[TEST_FRAMES * 2];
+static double ref[TEST_FRAMES * 2];
+
+/*
+    Double precision DF1 cascade, unrounded
+*/
+static void reference (const float (*coefs)[5], int sections)
+{
+    double st[2][BIQUAD_MAX_SECTIONS][4];
+    double x, y;
+    const float *c;
+    int n, ch, s;
+
+    memset (st, 0, sizeof (st));
+    for (n = 0; n < TEST_FRAMES; n++)
+    {
+        for (ch = 0; ch < 2; ch++)
+        {
+            x = input[2 * n + ch];
+            for (s = 0; s < sections; s++)
+            {
+                c = coefs[s];
+                y = c[0] * x + c[1] * st[ch][s][0] + c[2] * st[ch][s][1] - c[3] * st[ch][s][2] - c[4] * st[ch][s][3];
+                st[ch][s][1] = st[ch][s][0];
+                st[ch][s][0] = x;
+                st[ch][s][3] = st[ch][s][2];
+                st[ch][s][2] = y;
+                x = y;
+            }
+            ref[2 * n + ch] = x;
+        }
+    }
+}
+
+int main (void)
+{
+    static biquad_cascade_t bq;
+    float coefs[BIQUAD_BENCH_SECTIONS][5];
+    double err, sum, sum_sq, mean, rms;
+    uint32_t start, ns;
+    int f, k, s, i;
+
+    printf ("test_biquad\n");
+
+    // -12 dBFS white noise
+    test_srand (41);
+    for (i = 0; i < TEST_FRAMES * 2; i++)
+        input[i] = (int16_t) lroundf (8192 * test_noise ());
+
+    for (f = 0; f < sizeof (filters) / sizeof (filters[0]); f++)
+    {
+        for (s = 0; s < filters[f].sections; s++)
+            biquad_calc (filters[f].eq[s].type, filters[f].eq[s].freq, filters[f].eq[s].q,
+                filters[f].eq[s].gain_db, AUDIOSOM32_SAMPLERATE, coefs[s]);
+        reference (coefs, filters[f].sections);
+
+        printf (" %s\n", filters[f].name);
+        for (k = 0; k < BIQUAD_KERNELS; k++)
+        {
+            biquad_init (&bq, k, coefs, filters[f].sections);
+            memcpy (output, input, sizeof (input));
+            start = xthal_get_ccount ();
+            for (i = 0; i < TEST_FRAMES; i += TEST_BLOCK)
+                biquad_process (output + 2 * i, TEST_BLOCK, &bq);
+            ns = xthal_get_ccount () - start;
+
+            sum = sum_sq = 0;
+            for (i = 0; i < TEST_FRAMES * 2; i++)
+            {
+                err = output[i] - ref[i];
+                sum += err;
+                sum_sq += err * err;
+            }
+            mean = sum / (TEST_FRAMES * 2);
+            rms = sqrt (sum_sq / (TEST_FRAMES * 2));
+
+            printf ("  %-10s mean %+.3f LSB, RMS %.3f LSB, %.1f host ns/sample\n", kernel_names[k], mean, rms,
+                (double) ns / (TEST_FRAMES * 2));
+            if (k == BIQUAD_DF1_INT || k == BIQUAD_DF2T_INT)
+            {
+                TEST_CHECK (fabs (mean) < 0.05, "%s %s adds no DC", filters[f].name, kernel_names[k]);
+                TEST_CHECK (rms < filters[f].max_rms_int, "%s %s error below %.2f LSB RMS", filters[f].name,
+                    kernel_names[k], filters[f].max_rms_int);
+            }
+        }
+    }
+
+    return test_failures;
+}
@@ -0,0 +1,158 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+
+/*
+    Both DC blockers: the DC left from an input with an offset, the gain at
+    and around the corner, silence and a constant input settling to zero,
+    and the same output whatever the block size.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+// Application includes
+#include "host_test.h"
+// Both modules have a TAG of their own
+#define TAG dcblock_tag
+#include "../main/dcblock.c"
+#undef TAG
+#include "../main/biquad.c"
+
+#define RATE                AUDIOSOM32_SAMPLERATE
+#define TEST_FRAMES         (RATE * 4)
+#define TEST_BLOCK          512
+
+static const char *type_names[] = { "one-pole", "high-pass" };
+
+static int16_t buf[TEST_FRAMES * 2];
+static int16_t buf2[TEST_FRAMES * 2];
+
+static void run (dcblock_type_t type, int16_t *samples, size_t frames, size_t block)
+{
+    static dcblock_t dc;
+    size_t i, n;
+
+    dcblock_init (&dc, type, DCBLOCK_CORNER_HZ, RATE);
+    for (i = 0; i < frames; i += n)
+    {
+        n = frames - i < block ? frames - i : block;
+        dcblock_process (samples + 2 * i, n, &dc);
+    }
+}
+
+/*
+    Gain of a sine through the filter, dB, from its amplitude over the last
+    half (whole periods at the frequencies used). Left channel is the sine,
+    right the inverted sine.
+*/
+static float sine_gain (dcblock_type_t type, float freq)
+{
+    double s = 0, c = 0, ph;
+    int i, half = TEST_FRAMES / 2;
+
+    for (i = 0; i < TEST_FRAMES; i++)
+    {
+        buf[2*i] = (int16_t) lround (8192 * sin (2 * M_PI * freq * i / RATE));
+        buf[2*i + 1] = -buf[2*i];
+    }
+    run (type, buf, TEST_FRAMES, TEST_BLOCK);
+
+    for (i = half; i < TEST_FRAMES; i++)
+    {
+        ph = 2 * M_PI * freq * i / RATE;
+        s += (buf[2*i] - buf[2*i + 1]) * sin (ph);
+        c += (buf[2*i] - buf[2*i + 1]) * cos (ph);
+    }
+    // Both channels together: twice the amplitude, projection halves it
+    return 20 * log10 (sqrt (s * s + c * c) / (TEST_FRAMES - half) / 8192);
+}
+
+int main (void)
+{
+    double dc[2][2];
+    int32_t peak;
+    float g;
+    int t, i, k, ch;
+
+    printf ("test_dcblock\n");
+
+    for (t = DCBLOCK_ONE_POLE; t <= DCBLOCK_HIGHPASS; t++)
+    {
+        printf (" %s %d Hz\n", type_names[t], DCBLOCK_CORNER_HZ);
+
+        // -12 dBFS noise, then the same with +1000 LSB left and -1000 LSB
+        // right. The filtered noise has a mean of its own, the difference
+        // between the runs is the offset that got through.
+        for (k = 0; k < 2; k++)
+        {
+            test_srand (47);
+            for (i = 0; i < TEST_FRAMES * 2; i++)
+                buf[i] = (int16_t) lroundf (8192 * test_noise ()) + (k ? (i & 1 ? -1000 : 1000) : 0);
+            run (t, buf, TEST_FRAMES, TEST_BLOCK);
+            for (ch = 0; ch < 2; ch++)
+                for (dc[k][ch] = 0, i = TEST_FRAMES / 2; i < TEST_FRAMES; i++)
+                    dc[k][ch] += buf[2*i + ch] / (double) (TEST_FRAMES / 2);
+        }
+        TEST_CHECK (fabs (dc[1][0] - dc[0][0]) < 0.1 && fabs (dc[1][1] - dc[0][1]) < 0.1,
+            "+-1000 LSB offset under noise: %+.3f / %+.3f LSB left", dc[1][0] - dc[0][0], dc[1][1] - dc[0][1]);
+
+        // Constant input settles to zero, silence stays silent
+        for (i = 0; i < TEST_FRAMES * 2; i++)
+            buf[i] = 12000;
+        run (t, buf, TEST_FRAMES, TEST_BLOCK);
+        for (peak = 0, i = TEST_FRAMES; i < TEST_FRAMES * 2; i++)
+            peak = abs (buf[i]) > peak ? abs (buf[i]) : peak;
+        TEST_CHECK (peak <= 1, "constant 12000 LSB: peak %d LSB after 2 s", peak);
+
+        memset (buf, 0, sizeof (buf));
+        run (t, buf, TEST_FRAMES, TEST_BLOCK);
+        for (peak = 0, i = 0; i < TEST_FRAMES * 2; i++)
+            peak = abs (buf[i]) > peak ? abs (buf[i]) : peak;
+        TEST_CHECK (peak == 0, "silence: peak %d LSB", peak);
+
+        // -3 dB at the corner, a decade below it 6 or 12 dB per octave down
+        g = sine_gain (t, DCBLOCK_CORNER_HZ);
+        TEST_CHECK (fabsf (g + 3.01f) < 0.3f, "%d Hz: %.2f dB", DCBLOCK_CORNER_HZ, g);
+        g = sine_gain (t, DCBLOCK_CORNER_HZ / 10.0f);
+        TEST_CHECK (t == DCBLOCK_ONE_POLE ? fabsf (g + 20.0f) < 1 : fabsf (g + 40.0f) < 2,
+            "%.0f Hz: %.2f dB", DCBLOCK_CORNER_HZ / 10.0f, g);
+        g = sine_gain (t, DCBLOCK_CORNER_HZ * 10);
+        TEST_CHECK (g > -0.1f && g < 0.05f, "%d Hz: %.3f dB", DCBLOCK_CORNER_HZ * 10, g);
+        g = sine_gain (t, 1000);
+        TEST_CHECK (fabsf (g) < 0.01f, "1000 Hz: %.3f dB", g);
+
+        // Block size must not change the output
+        test_srand (47);
+        for (i = 0; i < TEST_FRAMES * 2; i++)
+            buf[i] = buf2[i] = (int16_t) lroundf (8192 * test_noise ()) + 1000;
+        run (t, buf, TEST_FRAMES, TEST_BLOCK);
+        run (t, buf2, TEST_FRAMES, 97);
+        TEST_CHECK (memcmp (buf, buf2, sizeof (buf)) == 0, "same output in blocks of %d and 97 frames", TEST_BLOCK);
+    }
+
+    return test_failures;
+}
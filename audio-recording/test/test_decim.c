@@ -0,0 +1,143 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+
+/*
+    The voice track decimator: gain across the passband and the stopband
+    (everything from 8 kHz up aliases into the 16 kHz track, so it must be
+    60 dB down), DC gain, one output per DECIM_FACTOR inputs, and the same
+    output whatever the block lengths.
+*/
+
+// System includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Application includes
+#include "host_test.h"
+#include "../main/decim.c"
+
+#define RATE                AUDIOSOM32_SAMPLERATE
+#define TEST_BLOCKS         40
+#define TEST_FRAMES         (TEST_BLOCKS * DECIM_MAX_FRAMES)
+
+typedef struct
+{
+    float freq;
+    float min_db, max_db;
+} tone_t;
+
+static const tone_t tones[] =
+{
+    {   100, -0.1f, 0.1f },
+    {  1000, -0.1f, 0.1f },
+    {  4000, -0.5f, 0.1f },
+    {  7000, -3.0f, -1.0f },
+    {  8000, -200, -60 },
+    {  9000, -200, -60 },
+    { 12000, -200, -60 },
+    { 16000, -200, -60 },
+    { 20000, -200, -60 },
+    { 23000, -200, -60 },
+};
+
+static int16_t input[TEST_FRAMES * 2];
+static int16_t out1[TEST_FRAMES / DECIM_FACTOR + 1];
+static int16_t out2[TEST_FRAMES / DECIM_FACTOR + 1];
+
+/*
+    Whole input through the decimator in blocks of the given length
+    (0: lengths 1 to 7 in turn), returns the number of outputs
+*/
+static size_t run (decim_t *dc, int channels, size_t block, int16_t *out)
+{
+    size_t i, len, n = 0;
+
+    decim_reset (dc);
+    for (i = 0; i < TEST_FRAMES; i += len)
+    {
+        len = block ? block : (i % 7) + 1;
+        if (len > TEST_FRAMES - i)
+            len = TEST_FRAMES - i;
+        n += decim_process (dc, input + i * channels, len, channels, out + n);
+    }
+    return n;
+}
+
+int main (void)
+{
+    static decim_t dc;
+    double sum_sq;
+    float g;
+    size_t n, n2, i;
+    int t;
+
+    printf ("test_decim\n");
+    TEST_CHECK (decim_init (&dc, RATE) == ESP_OK, "decimator for %d Hz", RATE);
+
+    // -6 dBFS tone on both channels, amplitude from the RMS after the filter
+    // has filled up. The phase offset keeps 8 kHz (the output Nyquist) off
+    // the zero crossings the output samples would land on.
+    for (t = 0; t < sizeof (tones) / sizeof (tones[0]); t++)
+    {
+        for (i = 0; i < TEST_FRAMES; i++)
+            input[2*i] = input[2*i + 1] = (int16_t) lround (16384 * sin (2 * M_PI * tones[t].freq * i / RATE + 0.3));
+        n = run (&dc, 2, DECIM_MAX_FRAMES, out1);
+        for (sum_sq = 0, i = DECIM_TAPS; i < n; i++)
+            sum_sq += (double) out1[i] * out1[i];
+        g = sum_sq > 0 ? 10 * log10 (2 * sum_sq / (n - DECIM_TAPS)) - 20 * log10 (16384) : -200;
+        TEST_CHECK (g >= tones[t].min_db && g <= tones[t].max_db, "%5.0f Hz: %.1f dB", tones[t].freq, g);
+    }
+
+    // Constant input keeps its level, L and -L cancel in the mid
+    for (i = 0; i < TEST_FRAMES; i++)
+    {
+        input[2*i] = 10000;
+        input[2*i + 1] = 10000;
+    }
+    n = run (&dc, 2, DECIM_MAX_FRAMES, out1);
+    TEST_CHECK (abs (out1[n - 1] - 10000) <= 2, "DC: 10000 LSB in, %d LSB out", out1[n - 1]);
+    TEST_CHECK (n == (TEST_FRAMES + DECIM_FACTOR - 1) / DECIM_FACTOR, "%zu outputs for %d frames", n, TEST_FRAMES);
+    for (i = 0; i < TEST_FRAMES; i++)
+        input[2*i + 1] = -10000;
+    n = run (&dc, 2, DECIM_MAX_FRAMES, out1);
+    TEST_CHECK (out1[n - 1] == 0, "L = -R: %d LSB out", out1[n - 1]);
+
+    // Block lengths change nothing, mono and stereo alike
+    test_srand (50);
+    for (i = 0; i < TEST_FRAMES * 2; i++)
+        input[i] = (int16_t) lroundf (10000 * test_noise ());
+    n = run (&dc, 1, DECIM_MAX_FRAMES, out1);
+    n2 = run (&dc, 1, 0, out2);
+    TEST_CHECK (n == n2 && memcmp (out1, out2, n * sizeof (int16_t)) == 0, "mono: same output in blocks of %d and of 1 to 7 frames",
+        DECIM_MAX_FRAMES);
+    n = run (&dc, 2, DECIM_MAX_FRAMES, out1);
+    n2 = run (&dc, 2, 97, out2);
+    TEST_CHECK (n == n2 && memcmp (out1, out2, n * sizeof (int16_t)) == 0, "stereo: same output in blocks of %d and 97 frames",
+        DECIM_MAX_FRAMES);
+
+    return test_failures;
+}
@@ -0,0 +1,235 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+
+/*
+    Noise spectrum of each dither mode: a 16384 point DFT of the output
+    error (output minus the 24-bit input) for a -60 dBFS sine, in dB
+    relative to 1 LSB^2, total and per band, and the error power at the
+    sine's harmonics against the floor around them. Checks that plain
+    rounding is correlated with the signal and TPDF is not, that shaping
+    moves noise out of the low band, and that the shaper recovers from
+    clipping. The same dither.c is in both apps.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+// Application includes
+#include "host_test.h"
+#include "../main/dither.c"
+
+#define RATE                48000
+#define DFT_POINTS          16384
+#define TEST_BLOCK          512
+#define SINE_BIN            341         // 999 Hz, a whole number of periods
+#define HARMONICS           10
+#define FLOOR_BINS          16          // Each side of a harmonic
+
+typedef struct
+{
+    float total, low, mid, high;        // dB re 1 LSB^2: all, 0-4 kHz, 4-12 kHz, 12-24 kHz
+    float harmonics;                    // Error power at harmonics 2 to HARMONICS
+    float harmonics_floor;              // Same number of bins of the floor around them
+} spectrum_t;
+
+static const char *mode_names[] = { "round", "TPDF", "TPDF+NS1", "TPDF+NS2" };
+
+static int32_t input[DFT_POINTS * 2];
+static int16_t output[DFT_POINTS * 2];
+static double re[DFT_POINTS], im[DFT_POINTS], power[DFT_POINTS / 2];
+
+/*
+    In place radix-2 FFT
+*/
+static void fft (double *x, double *y, int n)
+{
+    double wr, wi, tr, ti, a;
+    int i, j, k, len;
+
+    for (i = 1, j = 0; i < n; i++)
+    {
+        for (k = n >> 1; j & k; k >>= 1)
+            j ^= k;
+        j |= k;
+        if (i < j)
+        {
+            tr = x[i]; x[i] = x[j]; x[j] = tr;
+            ti = y[i]; y[i] = y[j]; y[j] = ti;
+        }
+    }
+    for (len = 2; len <= n; len <<= 1)
+        for (i = 0; i < n; i += len)
+            for (k = 0; k < len / 2; k++)
+            {
+                a = -2 * M_PI * k / len;
+                wr = cos (a);
+                wi = sin (a);
+                tr = x[i + k + len/2] * wr - y[i + k + len/2] * wi;
+                ti = x[i + k + len/2] * wi + y[i + k + len/2] * wr;
+                x[i + k + len/2] = x[i + k] - tr;
+                y[i + k + len/2] = y[i + k] - ti;
+                x[i + k] += tr;
+                y[i + k] += ti;
+            }
+}
+
+/*
+    24-bit sine in 32-bit slots (0 dBFS is 2^23 in 24 bits), level in dBFS,
+    -200 for silence. clip_frames at the start are a clipping full scale square.
+*/
+static void make_input (float db, int clip_frames)
+{
+    int32_t v;
+    int i;
+
+    for (i = 0; i < DFT_POINTS; i++)
+    {
+        v = db < -199 ? 0 : (int32_t) lround (8388608 * pow (10, db / 20) * sin (2 * M_PI * SINE_BIN * i / DFT_POINTS));
+        if (i < clip_frames)
+            v = (i / 24) & 1 ? -8388608 : 8388607;
+        input[2*i] = v * 256;
+        input[2*i + 1] = -v * 256;
+    }
+}
+
+static float db (double p)
+{
+    return 10 * log10 (p + 1e-30);
+}
+
+/*
+    Power spectrum of the output error, both channels averaged, frames
+    from skip on (the rest zeroed, for the clipping run)
+*/
+static void error_spectrum (dither_mode_t mode, spectrum_t *s, int skip)
+{
+    static dither_t dt;
+    double p, total = 0, low = 0, mid = 0, high = 0, harm = 0, floor = 0;
+    int i, ch, h, k;
+
+    dither_init (&dt, mode);
+    for (i = 0; i < DFT_POINTS; i += TEST_BLOCK)
+        dither_process (&dt, input + 2 * i, output + 2 * i, TEST_BLOCK);
+
+    memset (power, 0, sizeof (power));
+    for (ch = 0; ch < 2; ch++)
+    {
+        for (i = 0; i < DFT_POINTS; i++)
+        {
+            re[i] = i < skip ? 0 : output[2*i + ch] - (input[2*i + ch] >> 8) / 256.0;
+            im[i] = 0;
+        }
+        fft (re, im, DFT_POINTS);
+        // One-sided, mean square per bin
+        for (k = 1; k < DFT_POINTS / 2; k++)
+            power[k] += (re[k] * re[k] + im[k] * im[k]) / ((double) DFT_POINTS * DFT_POINTS);
+    }
+
+    for (k = 1; k < DFT_POINTS / 2; k++)
+    {
+        p = power[k];       // Two channels, the one-sided doubling cancels the average
+        total += p;
+        if (k < DFT_POINTS * 4000 / RATE)
+            low += p;
+        else if (k < DFT_POINTS * 12000 / RATE)
+            mid += p;
+        else
+            high += p;
+    }
+    for (h = 2; h <= HARMONICS; h++)
+    {
+        harm += power[h * SINE_BIN];
+        for (k = 1; k <= FLOOR_BINS; k++)
+            floor += (power[h * SINE_BIN - k] + power[h * SINE_BIN + k]) / (2 * FLOOR_BINS);
+    }
+
+    s->total = db (total);
+    s->low = db (low);
+    s->mid = db (mid);
+    s->high = db (high);
+    s->harmonics = db (harm);
+    s->harmonics_floor = db (floor);
+}
+
+int main (void)
+{
+    spectrum_t s[DITHER_MODES], quiet, loud, clipped;
+    int m;
+
+    printf ("test_dither\n");
+    printf ("  mode      total   0-4k   4-12k  12-24k  harmonics  floor\n");
+
+    make_input (-60, 0);
+    for (m = DITHER_ROUND; m < DITHER_MODES; m++)
+    {
+        error_spectrum (m, &s[m], 0);
+        printf ("  %-9s %5.1f  %5.1f   %5.1f   %5.1f    %5.1f    %5.1f\n", mode_names[m], s[m].total,
+            s[m].low, s[m].mid, s[m].high, s[m].harmonics, s[m].harmonics_floor);
+    }
+
+    // Rounding error of a uniform 1/12 LSB^2, TPDF adds 2/12
+    TEST_CHECK (fabsf (s[DITHER_ROUND].total + 10.8f) < 1, "round: %.1f dB total, about -10.8", s[DITHER_ROUND].total);
+    TEST_CHECK (fabsf (s[DITHER_TPDF].total + 6.0f) < 0.5f, "TPDF: %.1f dB total, about -6.0", s[DITHER_TPDF].total);
+
+    // Rounding puts distortion at the harmonics, dither turns it into floor
+    TEST_CHECK (s[DITHER_ROUND].harmonics > s[DITHER_ROUND].harmonics_floor + 6,
+        "round: harmonics %.1f dB above the floor", s[DITHER_ROUND].harmonics - s[DITHER_ROUND].harmonics_floor);
+    for (m = DITHER_TPDF; m < DITHER_MODES; m++)
+        TEST_CHECK (fabsf (s[m].harmonics - s[m].harmonics_floor) < 3,
+            "%s: harmonics %+.1f dB from the floor", mode_names[m], s[m].harmonics - s[m].harmonics_floor);
+
+    // TPDF noise does not depend on the signal, rounding silence is exact
+    make_input (-200, 0);
+    error_spectrum (DITHER_TPDF, &quiet, 0);
+    make_input (-20, 0);
+    error_spectrum (DITHER_TPDF, &loud, 0);
+    TEST_CHECK (fabsf (quiet.total - s[DITHER_TPDF].total) < 0.3f && fabsf (loud.total - s[DITHER_TPDF].total) < 0.3f,
+        "TPDF: %.1f dB on silence, %.1f dB at -20 dBFS", quiet.total, loud.total);
+    make_input (-200, 0);
+    error_spectrum (DITHER_ROUND, &quiet, 0);
+    TEST_CHECK (quiet.total < -200, "round: no error on silence");
+
+    // Shaping trades more total noise for less in the low band
+    TEST_CHECK (s[DITHER_TPDF_SHAPED1].low < s[DITHER_TPDF].low - 8,
+        "TPDF+NS1: 0-4 kHz %.1f dB below TPDF", s[DITHER_TPDF].low - s[DITHER_TPDF_SHAPED1].low);
+    TEST_CHECK (s[DITHER_TPDF_SHAPED2].low < s[DITHER_TPDF_SHAPED1].low - 5,
+        "TPDF+NS2: 0-4 kHz %.1f dB below TPDF+NS1", s[DITHER_TPDF_SHAPED1].low - s[DITHER_TPDF_SHAPED2].low);
+    TEST_CHECK (s[DITHER_TPDF_SHAPED2].high > s[DITHER_TPDF_SHAPED1].high && s[DITHER_TPDF_SHAPED1].high > s[DITHER_TPDF].high,
+        "12-24 kHz rises with the shaping order");
+
+    // Clipping full scale for 1/8 of the run, then the shaper settles back
+    for (m = DITHER_TPDF_SHAPED1; m < DITHER_MODES; m++)
+    {
+        make_input (-60, DFT_POINTS / 8);
+        error_spectrum (m, &clipped, DFT_POINTS / 4);
+        // A quarter of the frames zeroed: 10*log10 (3/4) less power
+        TEST_CHECK (fabsf (clipped.total + 1.25f - s[m].total) < 0.5f,
+            "%s after clipping: %.1f dB total", mode_names[m], clipped.total + 1.25f);
+    }
+
+    return test_failures;
+}
@@ -0,0 +1,126 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+/*
+    latency_correlate () against the chirp delayed by known amounts, as the
+    loopback cable would bring it back: attenuated, possibly inverted, with
+    noise on top. The lag found must be exact, and noise alone must not
+    produce one.
+    Then latency_run () end to end on the mock I2S loopback, which brings
+    the output back a known number of frames later for every DMA profile.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+
+// Application includes
+#include "host_test.h"
+#include "../main/latency.c"
+
+static int16_t chirp[LATENCY_CHIRP_FRAMES];
+static int16_t sig[LATENCY_WINDOW_FRAMES];
+
+/*
+    Window with the chirp at delay, scaled by gain (negative: inverted),
+    plus white noise of noise_amp peak
+*/
+static void make_signal (int32_t delay, float gain, float noise_amp)
+{
+    float v;
+    int i;
+
+    for (i = 0; i < LATENCY_WINDOW_FRAMES; i++)
+    {
+        v = noise_amp * test_noise ();
+        if (delay >= 0 && i >= delay && i < delay + LATENCY_CHIRP_FRAMES)
+            v += gain * chirp[i - delay];
+        sig[i] = (int16_t) lroundf (v);
+    }
+}
+
+int main (void)
+{
+    static const int32_t delays[] = { 0, 1, 37, 128, 229, 1000, 4096, LATENCY_WINDOW_FRAMES - LATENCY_CHIRP_FRAMES };
+    static const float gains[] = { 1.0f, -0.5f, 0.1f };
+    static const int32_t codec_delays[] = { 0, 29, 1000 };
+    int32_t lag;
+    int d, g, p;
+
+    printf ("test_latency\n");
+    latency_make_chirp (chirp, LATENCY_CHIRP_FRAMES);
+    test_srand (37);
+
+    for (d = 0; d < sizeof (delays) / sizeof (delays[0]); d++)
+    {
+        for (g = 0; g < sizeof (gains) / sizeof (gains[0]); g++)
+        {
+            // Noise about 30 dB below the chirp
+            make_signal (delays[d], gains[g], 0.03f * LATENCY_CHIRP_LEVEL * fabsf (gains[g]));
+            lag = latency_correlate (chirp, LATENCY_CHIRP_FRAMES, sig, LATENCY_WINDOW_FRAMES);
+            TEST_CHECK (lag == delays[d], "delay %4d, gain %+.2f: found %d", delays[d], gains[g], lag);
+        }
+    }
+
+    // Chirp just above the noise still found, noise alone (no cable) rejected
+    make_signal (700, 0.1f, 0.5f * 0.1f * LATENCY_CHIRP_LEVEL);
+    lag = latency_correlate (chirp, LATENCY_CHIRP_FRAMES, sig, LATENCY_WINDOW_FRAMES);
+    TEST_CHECK (lag == 700, "delay  700, noise at half the chirp peak: found %d", lag);
+
+    make_signal (-1, 0, 2000);
+    lag = latency_correlate (chirp, LATENCY_CHIRP_FRAMES, sig, LATENCY_WINDOW_FRAMES);
+    TEST_CHECK (lag == -1, "noise only: %d", lag);
+
+    memset (sig, 0, sizeof (sig));
+    lag = latency_correlate (chirp, LATENCY_CHIRP_FRAMES, sig, LATENCY_WINDOW_FRAMES);
+    TEST_CHECK (lag == -1, "silence: %d", lag);
+
+    // Window shorter than the chirp
+    lag = latency_correlate (chirp, LATENCY_CHIRP_FRAMES, sig, LATENCY_CHIRP_FRAMES - 1);
+    TEST_CHECK (lag == -1, "short window: %d", lag);
+
+    // No I2S: nothing measured
+    TEST_CHECK (latency_run () == ESP_FAIL, "no I2S: latency_run () fails");
+    TEST_CHECK (latency_lookup (AUDIOSOM32_DMA_BUF_COUNT, AUDIOSOM32_DMA_BUF_LEN) == -1,
+        "no I2S: nothing to look up");
+
+    for (d = 0; d < sizeof (codec_delays) / sizeof (codec_delays[0]); d++)
+    {
+        test_i2s_loopback = codec_delays[d];
+        TEST_CHECK (latency_run () == ESP_OK, "codec delay %4d: latency_run () measured", codec_delays[d]);
+        for (p = 0; p < LATENCY_PROFILES; p++)
+        {
+            if (latency_profiles[p].buf_len > AUDIOSOM32_DMA_BUF_LEN)
+                continue;
+            lag = latency_lookup (latency_profiles[p].buf_count, latency_profiles[p].buf_len);
+            TEST_CHECK (lag == test_i2s_delay (latency_profiles[p].buf_count, latency_profiles[p].buf_len),
+                "codec delay %4d, %d x %3d frames: %d, loop delay %d", codec_delays[d],
+                latency_profiles[p].buf_count, latency_profiles[p].buf_len, lag,
+                test_i2s_delay (latency_profiles[p].buf_count, latency_profiles[p].buf_len));
+        }
+    }
+    test_i2s_loopback = -1;
+
+    return test_failures;
+}
@@ -0,0 +1,289 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+
+/*
+    The VAD gate over a synthesized recording with a known script: speech-like
+    voiced bursts at several levels, quiet fricatives that only the zero
+    crossing rule catches, a low-frequency rumble and a fan that switches on
+    mid recording, which must not keep the gate open. Every active block must
+    be written, in order and with its pre-roll, and nothing far from activity.
+*/
+
+// System includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Application includes
+#include "host_test.h"
+#include "../main/vad.c"
+#include "writer.h"
+
+#define RATE                48000
+#define BLOCK_FRAMES        512
+#define BLOCK_SIZE          (BLOCK_FRAMES * 4)
+#define SECONDS             60
+#define BLOCKS              (SECONDS * RATE / BLOCK_FRAMES)
+#define NOISE_DB            -60         // Room noise, dBFS RMS
+#define FAN_START           35.0f       // Fan 20 dB above the room noise
+#define FAN_END             45.0f
+#define FAN_SETTLE          3.0f        // Seconds the gate may stay open after the fan starts
+#define SIDECAR             "build/test_vad.txt"
+
+typedef enum
+{
+    VOICED,                 // Harmonics of a wandering pitch, syllable envelope
+    FRICATIVE,              // High-passed noise, many zero crossings
+    RUMBLE,                 // Low-passed noise, not activity
+} event_type_t;
+
+typedef struct
+{
+    float start, length;    // Seconds
+    event_type_t type;
+    float db;               // dBFS RMS
+} event_t;
+
+static const event_t script[] =
+{
+    {  2.0f, 1.5f, VOICED, -20 },
+    {  5.0f, 0.3f, FRICATIVE, -54 },
+    {  7.0f, 3.0f, VOICED, -30 },
+    { 10.2f, 0.3f, FRICATIVE, -54 },
+    { 14.0f, 2.0f, VOICED, -35 },
+    { 20.0f, 0.4f, RUMBLE, -54 },
+    { 25.0f, 6.0f, VOICED, -25 },
+    { 40.0f, 2.0f, VOICED, -15 },
+    { 50.0f, 2.0f, VOICED, -30 },
+};
+#define EVENTS (sizeof (script) / sizeof (script[0]))
+
+static audio_block_pool_t pool = { NULL, BLOCK_SIZE, VAD_PREROLL_BLOCKS + 8, 0 };
+static void *blocks[BLOCKS];
+static bool written[BLOCKS];
+static int last_written;
+static bool out_of_order;
+
+static float db_amp (float db)
+{
+    return 32768.0f * powf (10, db / 20);
+}
+
+/*
+    Index of a block handed to the writer, blocks are never freed on the host
+    so their addresses stay unique
+*/
+static void hook (int stream, void *block, size_t len)
+{
+    int i;
+
+    for (i = BLOCKS - 1; i >= 0; i--)
+        if (blocks[i] == block)
+            break;
+    if (i < 0 || i <= last_written || len != BLOCK_SIZE)
+        out_of_order = true;
+    if (i >= 0)
+        written[i] = true;
+    last_written = i;
+}
+
+/*
+    What the gate lets through goes on to the writer, like rec_write ()
+*/
+static void to_writer (void *block, size_t len)
+{
+    writer_submit (0, &pool, block, len);
+}
+
+/*
+    One block of the script, or of the room noise alone. The filter states
+    carry over between blocks.
+*/
+static void make_block (int16_t *block, int n, bool events)
+{
+    static float room = 0, rumble = 0, prev = 0;
+    float t, v, w, f0, env;
+    int i, e, k;
+
+    for (i = 0; i < BLOCK_FRAMES; i++)
+    {
+        t = (float) (n * BLOCK_FRAMES + i) / RATE;
+
+        // Room noise is low-passed, so it rarely crosses zero (one pole at
+        // 0.95 leaves about 0.18 of the white noise RMS, uniform noise RMS is 0.58)
+        room += 0.05f * (test_noise () - room);
+        v = room / 0.18f / 0.58f * db_amp (NOISE_DB);
+        if (events && t >= FAN_START && t < FAN_END)
+            v *= 10;
+
+        for (e = 0; events && e < EVENTS; e++)
+        {
+            if (t < script[e].start || t >= script[e].start + script[e].length)
+                continue;
+            switch (script[e].type)
+            {
+            case VOICED:
+                f0 = 120 + 20 * sinf (2 * M_PI * 3 * t);
+                env = 0.5f - 0.5f * cosf (2 * M_PI * 4 * (t - script[e].start));
+                for (w = 0, k = 1; k <= 10; k++)
+                    w += sinf (2 * M_PI * k * f0 * t) / k;
+                // Harmonics 1/k sum to about 0.9 RMS, the envelope halves the power
+                v += w / 0.9f * 1.41f * env * db_amp (script[e].db);
+                break;
+            case FRICATIVE:
+                w = test_noise ();
+                v += (w - prev) / 0.82f * db_amp (script[e].db);
+                prev = w;
+                break;
+            case RUMBLE:
+                rumble += 0.05f * (test_noise () - rumble);
+                v += rumble / 0.18f / 0.58f * db_amp (script[e].db);
+                break;
+            }
+        }
+
+        block[2*i] = block[2*i + 1] = (int16_t) fmaxf (-32768, fminf (32767, lroundf (v)));
+    }
+}
+
+static bool speech_at (float t0, float t1)
+{
+    int e;
+
+    for (e = 0; e < EVENTS; e++)
+        if (script[e].type != RUMBLE && t1 > script[e].start && t0 < script[e].start + script[e].length)
+            return true;
+    return false;
+}
+
+/*
+    Run n blocks through the gate, returns the number written
+*/
+static int run (int n, bool events)
+{
+    int i, count = 0;
+
+    memset (written, 0, sizeof (written));
+    last_written = -1;
+    out_of_order = false;
+    test_blocks_returned = 0;
+
+    TEST_CHECK (vad_gate_start (&pool, to_writer, BLOCK_SIZE, RATE, 2) == ESP_OK, "gate started");
+    for (i = 0; i < n; i++)
+    {
+        blocks[i] = audio_block_get (&pool, 0);
+        make_block (blocks[i], i, events);
+        vad_gate_submit (blocks[i], BLOCK_SIZE);
+    }
+    TEST_CHECK (vad_gate_stop (SIDECAR) == ESP_OK, "gate stopped");
+    TEST_CHECK (test_blocks_returned == n, "every block back in the pool: %u of %d",
+        test_blocks_returned, n);
+    TEST_CHECK (!out_of_order, "blocks written in order");
+
+    for (i = 0; i < n; i++)
+    {
+        count += written[i];
+        free (blocks[i]);
+        blocks[i] = NULL;
+    }
+
+    return count;
+}
+
+/*
+    Sidecar regions must tile the written file and add up to what was written
+*/
+static void check_sidecar (int count)
+{
+    FILE *f;
+    char line[128];
+    float start, offset, length, end = 0;
+    int region, regions = 0;
+    bool tiled = true;
+
+    f = fopen (SIDECAR, "r");
+    TEST_CHECK (f != NULL, "sidecar written");
+    if (f == NULL)
+        return;
+    while (fgets (line, sizeof (line), f) != NULL)
+    {
+        if (line[0] == '#')
+            continue;
+        if (sscanf (line, "%d, %f, %f, %f", &region, &start, &offset, &length) != 4)
+            continue;
+        regions++;
+        if (region != regions || fabsf (offset - end) > 0.002f)
+            tiled = false;
+        end = offset + length;
+    }
+    fclose (f);
+
+    TEST_CHECK (regions > 0 && tiled, "sidecar: %d regions, back to back in the file", regions);
+    TEST_CHECK (fabsf (end - (float) count * BLOCK_FRAMES / RATE) < 0.002f,
+        "sidecar: regions add up to the written %.3f s", end);
+}
+
+int main (void)
+{
+    float block_s = (float) BLOCK_FRAMES / RATE, t;
+    int i, count, missed = 0, onsets = 0, stray = 0, speech = 0;
+
+    printf ("test_vad\n");
+    test_srand (44);
+    test_writer_hook = hook;
+
+    // Room noise alone writes nothing
+    count = run (10 * RATE / BLOCK_FRAMES, false);
+    TEST_CHECK (count == 0, "room noise only: %d blocks written", count);
+
+    count = run (BLOCKS, true);
+    for (i = 0; i < BLOCKS; i++)
+    {
+        t = i * block_s;
+        if (speech_at (t, t + block_s))
+        {
+            speech++;
+            missed += !written[i];
+            // Block before an onset is pre-roll
+            if (i > 0 && !speech_at (t - block_s, t))
+                onsets += written[i - 1];
+        }
+        // Written blocks far from speech, besides the fan settling (with its pre-roll)
+        else if (written[i] &&
+                 !speech_at (t - VAD_HANGOVER_MS / 1000.0f - 2 * block_s, t + (VAD_PREROLL_BLOCKS + 1) * block_s) &&
+                 !(t + (VAD_PREROLL_BLOCKS + 1) * block_s >= FAN_START && t < FAN_START + FAN_SETTLE))
+            stray++;
+    }
+
+    TEST_CHECK (missed == 0, "speech blocks missed: %d of %d", missed, speech);
+    TEST_CHECK (onsets == EVENTS - 1, "onsets with pre-roll: %d of %d", onsets, (int) EVENTS - 1);
+    TEST_CHECK (stray == 0, "blocks written away from speech (rumble, fan): %d", stray);
+    TEST_CHECK (count < speech + BLOCKS / 5, "written %.1f%% of the recording, speech is %.1f%%",
+        100.0f * count / BLOCKS, 100.0f * speech / BLOCKS);
+    check_sidecar (count);
+
+    return test_failures;
+}
@@ -0,0 +1,109 @@
+/*
+Website: www.pcbartists.com/audiosom32
+
+Copyright (C) 2021, PCB Artists OPC Pvt Ltd, all right reserved.
+Author:     Pratik Panda
+E-mail:     hello@pcbartists.com
+Website:    pcbartists.com
+
+The code referencing this license is open source software. Redistribution
+and use of the code in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    Redistribution of original and modified source code must retain the 
+    above copyright notice, this condition and the following disclaimer.
+
+    This code (or modifications) in source or binary forms may NOT be used
+    in a commercial application without obtaining permission from the Author.
+
+This software is provided by the copyright holder and contributors "AS IS"
+and any warranties related to this software are DISCLAIMED. The copyright 
+owner or contributors are NOT LIABLE for any damages caused by use of this 
+software.
+*/
+
+
+/*
+    wav_open_read () on files BACKING.WAV could be: a plain RIFF file, one
+    with an extra chunk before data, and malformed ones whose chunk sizes
+    would wrap the chunk walk or point past the end. Every call must return,
+    malformed files with -1.
+*/
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Application includes
+#include "host_test.h"
+#include "../main/wav.c"
+
+#define TEST_FILE           "build/test_wav.wav"
+
+static uint8_t file[256];
+
+static size_t put_chunk (size_t at, const char *id, uint32_t size, uint32_t body)
+{
+    memcpy (file + at, id, 4);
+    memcpy (file + at + 4, &size, 4);
+    return at + 8 + body;
+}
+
+/*
+    RIFF WAVE with a LIST chunk of list_size (list_body bytes really there),
+    fmt and 64 bytes of data. Returns the result of wav_open_read ().
+*/
+static int try_file (uint32_t list_size, uint32_t list_body, uint32_t *data_bytes)
+{
+    wav_header hdr;
+    size_t len;
+    int fd;
+
+    memset (file, 0, sizeof (file));
+    memcpy (file, "RIFF", 4);
+    memcpy (file + 8, "WAVE", 4);
+    len = put_chunk (12, "LIST", list_size, list_body);
+    len = put_chunk (len, "fmt ", 16, 16);
+    file[len - 16] = 1;                 // PCM
+    file[len - 14] = 2;                 // Stereo
+    len = put_chunk (len, "data", 64, 64);
+    len = len > sizeof (file) ? sizeof (file) : len;
+
+    fd = open (TEST_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    write (fd, file, len);
+    close (fd);
+
+    *data_bytes = 0;
+    fd = wav_open_read (TEST_FILE, &hdr, data_bytes);
+    if (fd >= 0)
+    {
+        close (fd);
+        return hdr.num_channels == 2 ? 1 : 0;
+    }
+    return -1;
+}
+
+int main (void)
+{
+    static const uint32_t bad[] = { 0xFFFFFFF8, 0xFFFFFFF7, 0xFFFFFFF0, 0x80000000, 1000 };
+    uint32_t data_bytes;
+    int i, ret;
+
+    printf ("test_wav\n");
+
+    ret = try_file (4, 4, &data_bytes);
+    TEST_CHECK (ret == 1 && data_bytes == 64, "LIST chunk before fmt: %d, %u data bytes", ret, data_bytes);
+    ret = try_file (3, 4, &data_bytes);
+    TEST_CHECK (ret == 1 && data_bytes == 64, "odd sized chunk with its pad byte: %d, %u data bytes", ret, data_bytes);
+
+    for (i = 0; i < sizeof (bad) / sizeof (bad[0]); i++)
+    {
+        ret = try_file (bad[i], 4, &data_bytes);
+        TEST_CHECK (ret == -1, "chunk size 0x%08X: rejected", bad[i]);
+    }
+
+    unlink (TEST_FILE);
+    return test_failures;
+}